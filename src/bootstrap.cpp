@@ -0,0 +1,121 @@
+#include "bootstrap.h"
+#include "threadpool.h"
+
+#include <random>
+#include <algorithm>
+
+void
+RankingBootstrap::addMatch (int first, int second, const RunningStats& r1,
+		const RunningStats& r2, int draw){
+	if (_totals.empty()){
+		_totals.assign(_players, 0);
+		_matches.assign(_players, 0);
+	}
+
+	if (draw < 0) draw = _draws.size();
+	if (draw >= (int) _draws.size()) _draws.resize(draw + 1);
+
+	if (r1.count()){
+		_totals[first] += r1.mean();
+		_matches[first]++;
+		Term t1 = {first, r1.stderror()};
+		_draws[draw].push_back(t1);
+	}
+
+	if (second < 0 || !r2.count()) return;
+	_totals[second] += r2.mean();
+	_matches[second]++;
+	Term t2 = {second, -r2.stderror()};
+	_draws[draw].push_back(t2);
+}
+
+/**
+ *  Orders players from the best to the worst score of a replicate.
+ */
+struct BetterScore {
+	const double* scores;
+
+	bool
+	operator() (int a, int b) const { return scores[a] > scores[b]; }
+};
+
+void
+RankingBootstrap::replicate (int from, int step, int replicates, unsigned int seed,
+		std::vector<double>* scores, std::vector<int>* ranks) const {
+	std::seed_seq seq = {seed, (unsigned int) from};
+	std::mt19937 generator(seq);
+	std::normal_distribution<double> normal;
+
+	std::vector<int> order(_players);
+	for (int r = from; r < replicates; r += step){
+		double* s = &(*scores)[r*_players];
+		for (int i=0; i<_players; i++)
+			s[i] = _totals[i];
+
+		for (unsigned int d=0; d<_draws.size(); d++){
+			double z = normal(generator);
+			for (std::vector<Term>::const_iterator it = _draws[d].begin(); it != _draws[d].end(); it++)
+				s[it->player] += z*it->scale;
+		}
+
+		for (int i=0; i<_players; i++){
+			s[i] = (_matches[i]) ? (s[i]/_matches[i])/2 : 0;
+			order[i] = i;
+		}
+
+		BetterScore better = {s};
+		std::sort(order.begin(), order.end(), better);
+		for (int i=0; i<_players; i++)
+			(*ranks)[r*_players + order[i]] = i + 1;
+	}
+}
+
+/**
+ *  Returns the sample quantile %q of %v, which is sorted.
+ */
+template <class T>
+static T
+quantile (const std::vector<T>& v, double q){
+	int i = std::min((int) (q*v.size()), (int) v.size() - 1);
+	return v[std::max(i, 0)];
+}
+
+void
+RankingBootstrap::run (int replicates, double confidence, int nthreads, unsigned int seed){
+	if (_totals.empty()){
+		_totals.assign(_players, 0);
+		_matches.assign(_players, 0);
+	}
+	if (replicates <= 0) return;
+	if (nthreads <= 0) nthreads = ThreadPool::shared().size();
+	nthreads = std::min(nthreads, replicates);
+
+	std::vector<double> scores(replicates*_players);
+	std::vector<int> ranks(replicates*_players);
+
+	TaskGroup group;
+	for (int t=0; t<nthreads; t++)
+		group.run(std::bind(&RankingBootstrap::replicate, this,
+				t, nthreads, replicates, seed, &scores, &ranks));
+	group.wait();
+
+	double tail = (1 - confidence)/2;
+	_intervals.resize(_players);
+	std::vector<double> s(replicates);
+	std::vector<int> k(replicates);
+	for (int i=0; i<_players; i++){
+		for (int r=0; r<replicates; r++){
+			s[r] = scores[r*_players + i];
+			k[r] = ranks[r*_players + i];
+		}
+		std::sort(s.begin(), s.end());
+		std::sort(k.begin(), k.end());
+
+		RankingInterval& in = _intervals[i];
+		in.scoreLower = quantile(s, tail);
+		in.scoreUpper = quantile(s, 1 - tail);
+		in.rankBest = quantile(k, tail);
+		in.rankWorst = quantile(k, 1 - tail);
+		in.replicates = replicates;
+	}
+}
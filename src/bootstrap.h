@@ -0,0 +1,112 @@
+#ifndef _BOOTSTRAP_H_
+#define _BOOTSTRAP_H_
+
+#include "stats.h"
+
+#include <vector>
+
+/**
+ *  @brief Bootstrap confidence intervals of the score and the rank of a
+ *  player.
+ */
+struct RankingInterval {
+	/**
+	 *  @brief Bounds of the score, in the units of Player::matchEv().
+	 */
+	double scoreLower, scoreUpper;
+
+	/**
+	 *  @brief Bounds of the rank. The best player has rank 1, so %rankBest is
+	 *  the lower one.
+	 */
+	int rankBest, rankWorst;
+
+	/**
+	 *  @brief Replicates the interval was computed from, 0 if it was not.
+	 */
+	int replicates;
+};
+
+/**
+ *  @brief Bootstrap of the scores and the ranking of a set of players from
+ *  the results of the matches they played.
+ *
+ *  In each replicate the mean of every match is redrawn from a normal with
+ *  the mean and the standard error of its hands, which is what resampling
+ *  its hands would give for matches of thousands of hands. The chips won by
+ *  one player of a match are lost by the other, so both means are moved by
+ *  the same draw in opposite directions. Scores are then recomputed as the
+ *  average of the player's matches, each one weighing the same as
+ *  Player::matchEv() does, and players ranked. Matches without hands do not
+ *  count. Replicates are split between tasks of the shared
+ *  ThreadPool, each one with its own random stream.
+ */
+class RankingBootstrap {
+public:
+	/**
+	 *  @brief Constructs the bootstrap of %nplayers players, numbered from 0.
+	 */
+	RankingBootstrap (int nplayers) : _players(nplayers) {}
+
+	/**
+	 *  @brief Adds the results of a match.
+	 *
+	 *  @param first Player of the first seat.
+	 *  @param second Player of the second seat, -1 if the results of the
+	 *  first one are not against a player of the set.
+	 *  @param r1 Chips credited to the first player in each hand.
+	 *  @param r2 Chips credited to the second player in each hand.
+	 *  @param draw Matches with the same %draw are redrawn together, which
+	 *  suits results credited to several players from a single match. -1
+	 *  gives the match a draw of its own.
+	 */
+	void
+	addMatch (int first, int second, const RunningStats& r1,
+			const RunningStats& r2 = RunningStats(), int draw = -1);
+
+	/**
+	 *  @brief Computes the intervals.
+	 *
+	 *  @param replicates Number of replicates.
+	 *  @param confidence Confidence level of the intervals.
+	 *  @param nthreads Number of tasks, 0 for one per thread of the pool.
+	 *  @param seed Seed of the random streams. The same seed and number of
+	 *  tasks give the same intervals.
+	 */
+	void
+	run (int replicates, double confidence = 0.95, int nthreads = 0, unsigned int seed = 0);
+
+	/**
+	 *  @brief Returns the intervals of a player, computed by run().
+	 */
+	const RankingInterval&
+	interval (int player) const { return _intervals.at(player); }
+
+private:
+	/**
+	 *  Part of a draw credited to a player: the standard error of the mean
+	 *  of the match, signed by the direction the draw moves it.
+	 */
+	struct Term {
+		int player;
+		double scale;
+	};
+
+	void
+	replicate (int from, int step, int replicates, unsigned int seed,
+			std::vector<double>* scores, std::vector<int>* ranks) const;
+
+	int _players;
+
+	/**
+	 *  Sum of the means of the matches of each player and number of them,
+	 *  and terms of each draw.
+	 */
+	std::vector<double> _totals;
+	std::vector<int> _matches;
+	std::vector<std::vector<Term> > _draws;
+
+	std::vector<RankingInterval> _intervals;
+};
+
+#endif
@@ -0,0 +1,210 @@
+#ifndef _BREAKDOWN_H_
+#define _BREAKDOWN_H_
+
+#include "handutils.h"
+#include "gameview.h"
+
+#include <vector>
+
+/**
+ *  @brief Number of effective stack buckets of an EvBreakdown. The first
+ *  four split the stacks dealt at random, the last one holds every deeper
+ *  stack.
+ */
+#define BREAKDOWN_NSTACKS 5
+
+/**
+ *  @brief Roles kept by an EvBreakdown: the small and the big blind.
+ */
+#define BREAKDOWN_NROLES 2
+
+/**
+ *  @brief Results and decisions of a player split by role, effective stack
+ *  bucket and hand class.
+ *
+ *  It is empty until enabled, and then costs a few counters per hand. Like
+ *  the rest of the counters of a player, breakdowns of disjoint sets of
+ *  hands can be merged, and since() undoes a merge.
+ *
+ *  Only hands played in the blinds are kept.
+ */
+class EvBreakdown {
+public:
+	/**
+	 *  @brief Counters of a cell.
+	 */
+	struct Cell {
+		unsigned int hands;
+
+		/**
+		 *  @brief Decisions taken and how many were aggressive, as counted
+		 *  by Player::countDecision.
+		 */
+		unsigned int decisions, aggressive;
+
+		/**
+		 *  @brief Chips credited, summed over the hands.
+		 */
+		double credited;
+	};
+
+	/**
+	 *  @brief Enables the breakdown with every counter set to 0.
+	 */
+	void
+	enable () { _cells.assign(BREAKDOWN_NROLES*BREAKDOWN_NSTACKS*NHANDS, Cell()); }
+
+	/**
+	 *  @brief Disables the breakdown and frees its counters.
+	 */
+	void
+	disable () { std::vector<Cell>().swap(_cells); }
+
+	/**
+	 *  @brief Returns true if the breakdown is enabled.
+	 */
+	bool
+	enabled () const { return !_cells.empty(); }
+
+	/**
+	 *  @brief Sets every counter to 0, if enabled.
+	 */
+	void
+	clear () { if (enabled()) enable(); }
+
+	/**
+	 *  @brief Returns the bucket of an effective stack, in chips.
+	 */
+	static int
+	stackBucket (int stack) {
+		if (stack <= 5) return 0;
+		if (stack <= 9) return 1;
+		if (stack <= 14) return 2;
+		if (stack <= 20) return 3;
+		return 4;
+	}
+
+	/**
+	 *  @brief Counts the result of a hand.
+	 *
+	 *  @param role PlayerRole of the player.
+	 *  @param hand Numeric representation of the hand dealt.
+	 *  @param stack Effective stack the hand was dealt with.
+	 *  @param credited Chips credited for the hand.
+	 */
+	void
+	add (int role, int hand, int stack, double credited) {
+		if (!enabled() || role >= BREAKDOWN_NROLES) return;
+		Cell& c = cell(role, stackBucket(stack), hand);
+		c.hands++;
+		c.credited += credited;
+	}
+
+	/**
+	 *  @brief Counts a decision.
+	 */
+	void
+	decision (int role, int hand, int stack, bool aggressive) {
+		if (!enabled() || role >= BREAKDOWN_NROLES) return;
+		Cell& c = cell(role, stackBucket(stack), hand);
+		c.decisions++;
+		if (aggressive) c.aggressive++;
+	}
+
+	/**
+	 *  @brief Adds the counters of another breakdown. Nothing is done if any
+	 *  of them is disabled.
+	 */
+	void
+	merge (const EvBreakdown& other) {
+		if (!enabled() || !other.enabled()) return;
+		for (unsigned int i=0; i<_cells.size(); i++){
+			_cells[i].hands += other._cells[i].hands;
+			_cells[i].decisions += other._cells[i].decisions;
+			_cells[i].aggressive += other._cells[i].aggressive;
+			_cells[i].credited += other._cells[i].credited;
+		}
+	}
+
+	/**
+	 *  @brief Returns the counters gathered since an earlier copy of this
+	 *  breakdown.
+	 */
+	EvBreakdown
+	since (const EvBreakdown& before) const {
+		EvBreakdown d = *this;
+		if (!enabled() || !before.enabled()) return d;
+		for (unsigned int i=0; i<_cells.size(); i++){
+			d._cells[i].hands -= before._cells[i].hands;
+			d._cells[i].decisions -= before._cells[i].decisions;
+			d._cells[i].aggressive -= before._cells[i].aggressive;
+			d._cells[i].credited -= before._cells[i].credited;
+		}
+		return d;
+	}
+
+	/**
+	 *  @brief Returns the counters of a cell. The breakdown must be enabled.
+	 *
+	 *  @param role PlayerRole of the player.
+	 *  @param bucket Effective stack bucket, as given by stackBucket().
+	 *  @param hand Numeric representation of the hand.
+	 */
+	const Cell&
+	cell (int role, int bucket, int hand) const {
+		return _cells[(role*BREAKDOWN_NSTACKS + bucket)*NHANDS + hand]; }
+
+	/**
+	 *  @brief Returns the chips won per hand in a cell, in big blinds, 0 if
+	 *  it has no hands.
+	 *
+	 *  Under importance sampling each hand is credited with the weight of its
+	 *  deal, so only contribution() can be compared between cells.
+	 */
+	double
+	ev (int role, int bucket, int hand) const {
+		const Cell& c = cell(role, bucket, hand);
+		return (c.hands) ? (c.credited/c.hands)/2 : 0;
+	}
+
+	/**
+	 *  @brief Returns the share of a cell in the ev of the player, in big
+	 *  blinds per hand. Summed over every cell it gives ev() if every hand
+	 *  was played in the blinds.
+	 */
+	double
+	contribution (int role, int bucket, int hand) const {
+		unsigned long int n = hands();
+		return (n) ? (cell(role, bucket, hand).credited/n)/2 : 0;
+	}
+
+	/**
+	 *  @brief Returns the ratio of aggressive decisions in a cell, -1 if it
+	 *  has none.
+	 */
+	float
+	frequency (int role, int bucket, int hand) const {
+		const Cell& c = cell(role, bucket, hand);
+		return (c.decisions) ? c.aggressive/(float) c.decisions : -1;
+	}
+
+	/**
+	 *  @brief Returns the number of hands counted.
+	 */
+	unsigned long int
+	hands () const {
+		unsigned long int n = 0;
+		for (unsigned int i=0; i<_cells.size(); i++)
+			n += _cells[i].hands;
+		return n;
+	}
+
+private:
+	Cell&
+	cell (int role, int bucket, int hand) {
+		return _cells[(role*BREAKDOWN_NSTACKS + bucket)*NHANDS + hand]; }
+
+	std::vector<Cell> _cells;
+};
+
+#endif
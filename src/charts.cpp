@@ -0,0 +1,112 @@
+#include "charts.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const unsigned long long PushFoldChart::_none[CHART_WORDS] = {0};
+
+int
+ChartDatabaseWriter::add (const ChartStructure& structure){
+	_structures.push_back(structure);
+	_words.resize(_words.size() + CHART_WORDS, 0);
+	return _structures.size() - 1;
+}
+
+int
+ChartDatabaseWriter::addMaxStacks (const ChartStructure& structure, const unsigned char* sb,
+		const unsigned char* bb){
+	int chart = add(structure);
+	for (int s=0; s<CHART_ROWS; s++)
+		for (int h=0; h<NHANDS; h++){
+			play(chart, PlayerRole::SB, s, h, s <= sb[h]);
+			play(chart, PlayerRole::BB, s, h, s <= bb[h]);
+		}
+
+	return chart;
+}
+
+void
+ChartDatabaseWriter::play (int chart, int role, int stack, int hand, bool b){
+	unsigned long long* mask = &_words[chart*CHART_WORDS
+			+ (PushFoldChart::row(stack)*2 + (role != PlayerRole::SB))*HAND_WORDS];
+	if (b) mask[hand >> 6] |= 1ULL << (hand & 63);
+	else mask[hand >> 6] &= ~(1ULL << (hand & 63));
+}
+
+void
+ChartDatabaseWriter::write (std::ostream& out) const {
+	int n = _structures.size();
+
+	ChartsHeader header;
+	header.magic = CHARTS_MAGIC;
+	header.version = CHARTS_VERSION;
+	header.ncharts = n;
+
+	// Charts are aligned so that they can be read in place once mapped.
+	unsigned long long tables = sizeof(ChartsHeader) + n*sizeof(ChartsEntry);
+	unsigned long long offset = (tables + 7) & ~7ULL;
+
+	std::vector<ChartsEntry> entries(n);
+	for (int i=0; i<n; i++){
+		entries[i].structure = _structures[i];
+		entries[i].reserved = 0;
+		entries[i].offset = offset + (unsigned long long) i*CHART_WORDS*sizeof(unsigned long long);
+	}
+
+	const char padding[8] = {0};
+	out.write((const char*) &header, sizeof(header));
+	if (n) out.write((const char*) &entries[0], n*sizeof(ChartsEntry));
+	out.write(padding, offset - tables);
+	if (n) out.write((const char*) &_words[0], _words.size()*sizeof(unsigned long long));
+	out.flush();
+}
+
+ChartDatabase::ChartDatabase (const char* filename) :
+	_map(0),
+	_size(0),
+	_header(0),
+	_entries(0)
+{
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) return;
+
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size >= (off_t) sizeof(ChartsHeader)){
+		_size = st.st_size;
+		_map = mmap(0, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (_map == MAP_FAILED) _map = 0;
+	}
+	close(fd);
+	if (!_map) return;
+
+	const char* base = (const char*) _map;
+	const ChartsHeader* header = (const ChartsHeader*) base;
+	if (header->magic != CHARTS_MAGIC || header->version != CHARTS_VERSION
+			|| sizeof(ChartsHeader) + (unsigned long long) header->ncharts*sizeof(ChartsEntry) > _size)
+		return;
+
+	const ChartsEntry* entries = (const ChartsEntry*) (base + sizeof(ChartsHeader));
+	for (unsigned int i=0; i<header->ncharts; i++)
+		if ((entries[i].offset & 7)
+				|| entries[i].offset + CHART_WORDS*sizeof(unsigned long long) > _size)
+			return;
+
+	_entries = entries;
+	_header = header;
+}
+
+ChartDatabase::~ChartDatabase (){
+	if (_map) munmap(_map, _size);
+}
+
+int
+ChartDatabase::find (int sb, int bb, int ante) const {
+	for (int i=0; i<size(); i++){
+		const ChartStructure& s = _entries[i].structure;
+		if (s.sb == sb && s.bb == bb && s.ante == ante) return i;
+	}
+
+	return -1;
+}
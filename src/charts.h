@@ -0,0 +1,239 @@
+#ifndef _CHARTS_H_
+#define _CHARTS_H_
+
+#include <iostream>
+#include <vector>
+
+#include "strategy.h"
+
+/**
+ *  @brief Identifies a chart database file.
+ */
+#define CHARTS_MAGIC 0x4348464e
+#define CHARTS_VERSION 1
+
+/**
+ *  @brief Biggest effective stack with its own row in a chart. Bigger stacks
+ *  use the last row.
+ */
+#define CHART_MAX_STACK 50
+#define CHART_ROWS (CHART_MAX_STACK + 1)
+
+/**
+ *  @brief Number of 64 bit words of a chart: one bit per hand, role and
+ *  effective stack.
+ */
+#define CHART_WORDS (CHART_ROWS*2*HAND_WORDS)
+
+/**
+ *  @brief Blind structure a chart was solved for, in chips.
+ */
+struct ChartStructure {
+	unsigned short sb;
+	unsigned short bb;
+	unsigned short ante;
+} __attribute__((packed));
+
+/**
+ *  @brief Header at the beginning of a chart database.
+ */
+struct ChartsHeader {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int ncharts;
+} __attribute__((packed));
+
+/**
+ *  @brief Description of a chart stored in a database.
+ */
+struct ChartsEntry {
+	ChartStructure structure;
+	unsigned short reserved;
+
+	/**
+	 *  @brief Position of the CHART_WORDS words of the chart, from the
+	 *  beginning of the file. It is a multiple of 8.
+	 */
+	unsigned long long offset;
+} __attribute__((packed));
+
+/**
+ *  @brief Read only view of a push/fold chart: for every effective stack up
+ *  to CHART_MAX_STACK, the hands that go all-in as small blind and those
+ *  that call the shove as big blind.
+ *
+ *  Rows are laid out as in CompiledStrategy, so a decision is a single bit
+ *  test. Hands are identified by handToNumeric.
+ */
+class PushFoldChart {
+public:
+	/**
+	 *  @brief Creates a chart that folds every hand.
+	 */
+	PushFoldChart () : _masks(_none) {}
+
+	/**
+	 *  @brief Creates a view of CHART_WORDS words laid out by row, role and
+	 *  hand word.
+	 */
+	PushFoldChart (const unsigned long long* masks) : _masks(masks) {}
+
+	/**
+	 *  @brief Returns true if the hand must be played at the given effective
+	 *  stack.
+	 *
+	 *  @param role SB to go all-in. Any other role calls.
+	 *  @param stack Effective stack.
+	 *  @param hand Numeric representation of the hand.
+	 */
+	bool
+	aggressive (int role, int stack, int hand) const {
+		const unsigned long long* mask = _masks + (row(stack)*2 + (role != PlayerRole::SB))*HAND_WORDS;
+		return (mask[hand >> 6] >> (hand & 63)) & 1;
+	}
+
+	/**
+	 *  @brief Returns the words of the chart.
+	 */
+	const unsigned long long*
+	masks () const { return _masks; }
+
+	/**
+	 *  @brief Returns the row that holds the given effective stack.
+	 */
+	static int
+	row (int stack) { return (stack < 0) ? 0 : (stack > CHART_MAX_STACK) ? CHART_MAX_STACK : stack; }
+
+private:
+	const unsigned long long* _masks;
+
+	static const unsigned long long _none[CHART_WORDS];
+};
+
+/**
+ *  @brief Gathers charts and writes them as a database.
+ *
+ *  A database holds the header, one entry per chart and then the words of
+ *  every chart, in the same order as the entries.
+ */
+class ChartDatabaseWriter {
+public:
+	/**
+	 *  @brief Adds a chart that folds every hand.
+	 *
+	 *  @return Its position, to fill it with play().
+	 */
+	int
+	add (const ChartStructure& structure);
+
+	/**
+	 *  @brief Adds a chart given the biggest effective stack at which each
+	 *  hand is played, the format of the charts of PlayerNash.
+	 *
+	 *  @param structure Blind structure.
+	 *  @param sb Biggest stack at which each hand goes all-in, indexed by the
+	 *  numeric representation of the hand.
+	 *  @param bb Biggest stack at which each hand calls.
+	 *  @return Its position.
+	 */
+	int
+	addMaxStacks (const ChartStructure& structure, const unsigned char* sb,
+			const unsigned char* bb);
+
+	/**
+	 *  @brief Sets whether a hand is played at the given effective stack.
+	 *
+	 *  @param chart Position of the chart.
+	 *  @param role SB to go all-in. Any other role calls.
+	 *  @param stack Effective stack, up to CHART_MAX_STACK.
+	 *  @param hand Numeric representation of the hand.
+	 *  @param b True to play it.
+	 */
+	void
+	play (int chart, int role, int stack, int hand, bool b);
+
+	/**
+	 *  @brief Writes the database.
+	 *
+	 *  @param out Binary stream where the database will be placed.
+	 */
+	void
+	write (std::ostream& out) const;
+
+	/**
+	 *  @brief Returns the number of charts added so far.
+	 */
+	int
+	size () const { return _structures.size(); }
+
+private:
+	std::vector<ChartStructure> _structures;
+	std::vector<unsigned long long> _words;
+};
+
+/**
+ *  @brief Read only view of a chart database file.
+ *
+ *  The file is memory mapped and charts are read in place, so it may be
+ *  shared by every thread and player. It must outlive the charts taken
+ *  from it.
+ */
+class ChartDatabase {
+public:
+	/**
+	 *  @brief Maps a database file.
+	 *
+	 *  @param filename Path of the database.
+	 */
+	ChartDatabase (const char* filename);
+
+	/**
+	 *  @brief Unmaps the file.
+	 */
+	~ChartDatabase ();
+
+	/**
+	 *  @brief Returns false if the file could not be mapped or is not a
+	 *  chart database.
+	 */
+	bool
+	valid () const { return _header != 0; }
+
+	/**
+	 *  @brief Returns the number of charts.
+	 */
+	int
+	size () const { return (_header) ? _header->ncharts : 0; }
+
+	/**
+	 *  @brief Returns the blind structure of a chart.
+	 */
+	const ChartStructure&
+	structure (int i) const { return _entries[i].structure; }
+
+	/**
+	 *  @brief Returns the position of the chart of a blind structure, or -1
+	 *  if there is none.
+	 */
+	int
+	find (int sb, int bb, int ante) const;
+
+	/**
+	 *  @brief Returns a chart.
+	 */
+	PushFoldChart
+	chart (int i) const {
+		return PushFoldChart((const unsigned long long*) ((const char*) _map + _entries[i].offset)); }
+
+private:
+	ChartDatabase (const ChartDatabase&);
+	ChartDatabase& operator= (const ChartDatabase&);
+
+	void* _map;
+	unsigned long long _size;
+
+	const ChartsHeader* _header;
+	const ChartsEntry* _entries;
+};
+
+#endif
@@ -17,3 +17,8 @@ int Deck::popCard(){
 
 	return card;
 }
+
+void Deck::remove(int card){
+	std::vector<int>::iterator it = std::find(_deck.begin(),_deck.end(),card);
+	if (it != _deck.end()) _deck.erase(it);
+}
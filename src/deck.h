@@ -25,6 +25,15 @@ public:
 	int
 	popCard ();
 
+	/**
+	 *  @brief Takes a card out of the deck, wherever it is, so that it is
+	 *  never popped. Nothing happens if it is not in the deck.
+	 *
+	 *  @param card Identifier of the card.
+	 */
+	void
+	remove (int card);
+
 private:
 	std::vector<int> _deck;
 };
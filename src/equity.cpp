@@ -0,0 +1,544 @@
+#include "equity.h"
+
+#include <cstring>
+#include <cstdio>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include <pbots_calc/pbots_calc.h>
+
+/**
+ *  Exact equity of every class against every other one, and of every class
+ *  against the classes of the ranking, weighted by their combinations and
+ *  summed in ranking order. Both are filled once, before _tableReady is set,
+ *  and only read afterwards.
+ */
+static float _equity[NHANDS][NHANDS];
+static double _prefix[NHANDS][NHANDS+1];
+static std::atomic<bool> _tableReady(false);
+static std::once_flag _tableOnce;
+
+static std::vector<int>
+prefixCombos (){
+	std::vector<int> combos(NHANDS+1, 0);
+	for (int r=0; r<NHANDS; r++)
+		combos[r+1] = combos[r] + handCombos(hand_order[r]);
+	return combos;
+}
+
+/**
+ *  Returns the highest card of the best straight among the strengths set in
+ *  %m, -1 if there is none. Strengths go from 0 for a deuce to 12 for an ace,
+ *  which also plays below the deuce.
+ */
+static int
+straightHigh (int m){
+	int w = (m << 1) | ((m >> 12) & 1);
+	int s = w & (w >> 1) & (w >> 2) & (w >> 3) & (w >> 4);
+	return (s) ? 31 - __builtin_clz(s) + 3 : -1;
+}
+
+/**
+ *  Returns the %n highest strengths set in %m, four bits each.
+ */
+static int
+topCards (int m, int n){
+	int v = 0;
+	for (; n; n--){
+		int s = 31 - __builtin_clz(m);
+		v = (v << 4) | s;
+		m &= ~(1 << s);
+	}
+	return v;
+}
+
+/**
+ *  Returns the value of the best five card hand among seven cards, higher for
+ *  better hands and equal for ties. The category takes the highest bits and
+ *  the strengths that break ties the 20 lowest ones.
+ *
+ *  @param count Number of cards of each strength.
+ *  @param suited Strengths held in each suit, one bit each.
+ */
+static int
+handValue (const int* count, const int* suited){
+	for (int s=0; s<4; s++){
+		if (__builtin_popcount(suited[s]) < 5) continue;
+		int h = straightHigh(suited[s]);
+		return (h >= 0) ? (8 << 20) | h : (5 << 20) | topCards(suited[s], 5);
+	}
+
+	int present = suited[0] | suited[1] | suited[2] | suited[3];
+	int quads = -1, trips = -1, pair = -1, second = -1;
+	for (int r=12; r>=0; r--){
+		if (count[r] == 4) quads = r;
+		else if (count[r] == 3 && trips < 0) trips = r;
+		else if (count[r] >= 2 && pair < 0) pair = r;
+		else if (count[r] == 2 && second < 0) second = r;
+	}
+
+	if (quads >= 0) return (7 << 20) | (quads << 4) | topCards(present & ~(1 << quads), 1);
+	if (trips >= 0 && pair >= 0) return (6 << 20) | (trips << 4) | pair;
+
+	int h = straightHigh(present);
+	if (h >= 0) return (4 << 20) | h;
+
+	if (trips >= 0) return (3 << 20) | (trips << 8) | topCards(present & ~(1 << trips), 2);
+	if (second >= 0) return (2 << 20) | (pair << 8) | (second << 4)
+			| topCards(present & ~(1 << pair) & ~(1 << second), 1);
+	if (pair >= 0) return (1 << 20) | (pair << 12) | topCards(present & ~(1 << pair), 3);
+	return topCards(present, 5);
+}
+
+/**
+ *  Two card combination of the deck.
+ */
+struct Combo {
+	int card[2];
+	int hand;
+};
+
+/**
+ *  Combinations of the deck, and the ones that hold each card.
+ */
+struct ComboTable {
+	Combo combos[NCOMBOS];
+	int holding[52][51];
+
+	ComboTable (){
+		int n = 0, held[52] = {0};
+		for (int a=0; a<52; a++)
+			for (int b=a+1; b<52; b++){
+				Combo& c = combos[n];
+				c.card[0] = a;
+				c.card[1] = b;
+				c.hand = handToNumeric(Card(a), Card(b));
+				holding[a][held[a]++] = holding[b][held[b]++] = n++;
+			}
+	}
+};
+
+/**
+ *  Returns the boards that stay the same or get bigger under every
+ *  permutation of the suits, with the number of boards each one stands for.
+ *  Since classes do not depend on suits, every board of a class of
+ *  permutations gives the same results.
+ */
+static void
+canonicalBoards (std::vector<unsigned long long>* boards, std::vector<int>* weights){
+	int perms[24][4], n = 0;
+	int suit[4] = {0, 1, 2, 3};
+	do {
+		std::copy(suit, suit + 4, perms[n++]);
+	} while (std::next_permutation(suit, suit + 4));
+
+	int c[5];
+	for (c[0]=0; c[0]<52; c[0]++)
+	for (c[1]=c[0]+1; c[1]<52; c[1]++)
+	for (c[2]=c[1]+1; c[2]<52; c[2]++)
+	for (c[3]=c[2]+1; c[3]<52; c[3]++)
+	for (c[4]=c[3]+1; c[4]<52; c[4]++){
+		unsigned long long board = 0, images[24];
+		for (int i=0; i<5; i++)
+			board |= 1ULL << c[i];
+
+		bool canonical = true;
+		for (int p=0; p<24 && canonical; p++){
+			unsigned long long m = 0;
+			for (int s=0; s<4; s++)
+				m |= ((board >> (s*CARDS_PER_SUIT)) & 0x1fff) << (perms[p][s]*CARDS_PER_SUIT);
+			images[p] = m;
+			canonical = (m >= board);
+		}
+		if (!canonical) continue;
+
+		std::sort(images, images + 24);
+		boards->push_back(board);
+		weights->push_back(std::unique(images, images + 24) - images);
+	}
+}
+
+/**
+ *  Adds to %score the outcomes of every pair of disjoint combinations on the
+ *  boards %from, %from + %step... Each pair adds 2 to the class of the winner
+ *  and 1 to both on a tie, times the weight of the board.
+ */
+static void
+scoreBoards (const ComboTable* table, const std::vector<unsigned long long>* boards,
+		const std::vector<int>* weights, int from, int step, std::vector<long long>* score){
+	std::vector<int> value(NCOMBOS);
+	std::vector<long long> order;
+	order.reserve(NCOMBOS);
+	long long less[NHANDS], same[NHANDS];
+	std::vector<int> touched;
+
+	for (unsigned int i=from; i<boards->size(); i+=step){
+		unsigned long long board = (*boards)[i];
+		long long w = (*weights)[i];
+
+		int count[13] = {0}, suited[4] = {0};
+		for (unsigned long long m = board; m; m &= m - 1){
+			int id = __builtin_ctzll(m), s = 12 - id%CARDS_PER_SUIT;
+			count[s]++;
+			suited[id/CARDS_PER_SUIT] |= 1 << s;
+		}
+
+		order.clear();
+		for (int k=0; k<NCOMBOS; k++){
+			const Combo& c = table->combos[k];
+			if (((board >> c.card[0]) | (board >> c.card[1])) & 1){
+				value[k] = -1;
+				continue;
+			}
+
+			int cnt[13], sut[4];
+			std::copy(count, count + 13, cnt);
+			std::copy(suited, suited + 4, sut);
+			for (int j=0; j<2; j++){
+				int s = 12 - c.card[j]%CARDS_PER_SUIT;
+				cnt[s]++;
+				sut[c.card[j]/CARDS_PER_SUIT] |= 1 << s;
+			}
+			value[k] = handValue(cnt, sut);
+			order.push_back(((long long) value[k] << 11) | k);
+		}
+		std::sort(order.begin(), order.end());
+
+		std::fill(less, less + NHANDS, 0);
+		std::fill(same, same + NHANDS, 0);
+		for (unsigned int g=0; g<order.size(); ){
+			unsigned int end = g;
+			int v = order[g] >> 11;
+			while (end < order.size() && (order[end] >> 11) == v){
+				int h = table->combos[order[end] & 0x7ff].hand;
+				if (!same[h]++) touched.push_back(h);
+				end++;
+			}
+
+			// Every combination of the group against every other one
+			// available, then the ones sharing a card are taken back.
+			for (unsigned int t=0; t<touched.size(); t++){
+				long long* row = &(*score)[touched[t]*NHANDS];
+				long long n = w*same[touched[t]];
+				for (int h=0; h<NHANDS; h++)
+					row[h] += n*(2*less[h] + same[h]);
+			}
+
+			for (unsigned int x=g; x<end; x++){
+				const Combo& c = table->combos[order[x] & 0x7ff];
+				long long* row = &(*score)[c.hand*NHANDS];
+				for (int j=0; j<2; j++)
+					for (int y=0; y<51; y++){
+						int k = table->holding[c.card[j]][y];
+						if (value[k] < 0 || value[k] > v) continue;
+						if (j && k == (int) (order[x] & 0x7ff)) continue;
+						row[table->combos[k].hand] -= (value[k] < v) ? 2*w : w;
+					}
+			}
+
+			for (unsigned int t=0; t<touched.size(); t++){
+				less[touched[t]] += same[touched[t]];
+				same[touched[t]] = 0;
+			}
+			touched.clear();
+			g = end;
+		}
+	}
+}
+
+/**
+ *  Fills the prefix sums and publishes the table.
+ */
+static void
+publishTable (){
+	for (int hand=0; hand<NHANDS; hand++){
+		_prefix[hand][0] = 0;
+		for (int r=0; r<NHANDS; r++){
+			int g = hand_order[r];
+			_prefix[hand][r+1] = _prefix[hand][r] + handCombos(g)*_equity[hand][g];
+		}
+	}
+	_tableReady.store(true, std::memory_order_release);
+}
+
+/**
+ *  Computes the table by enumerating every board for every pair of
+ *  combinations, split between threads of its own: it may be first needed
+ *  from a task of the shared ThreadPool, which must not wait for others.
+ */
+static void
+computeTable (){
+	ComboTable* table = new ComboTable();
+	std::vector<unsigned long long> boards;
+	std::vector<int> weights;
+	canonicalBoards(&boards, &weights);
+
+	int nthreads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<std::vector<long long> > scores(nthreads, std::vector<long long>(NHANDS*NHANDS, 0));
+	std::vector<std::thread> threads;
+	for (int t=0; t<nthreads; t++)
+		threads.push_back(std::thread(scoreBoards, table, &boards, &weights, t, nthreads, &scores[t]));
+	for (int t=0; t<nthreads; t++)
+		threads[t].join();
+	delete table;
+
+	for (int t=1; t<nthreads; t++)
+		for (int i=0; i<NHANDS*NHANDS; i++)
+			scores[0][i] += scores[t][i];
+
+	const long long* s = &scores[0][0];
+	for (int a=0; a<NHANDS; a++)
+		for (int b=0; b<NHANDS; b++)
+			_equity[a][b] = s[a*NHANDS + b]/(double) (s[a*NHANDS + b] + s[b*NHANDS + a]);
+
+	publishTable();
+}
+
+/**
+ *  Makes sure the table is ready. Once it is, this is a single load.
+ */
+static inline void
+requireTable (){
+	if (!_tableReady.load(std::memory_order_acquire))
+		std::call_once(_tableOnce, computeTable);
+}
+
+bool
+loadClassEquities (const char* filename){
+	FILE* in = fopen(filename, "rb");
+	if (!in) return false;
+	unsigned int header[3];
+	static float equity[NHANDS][NHANDS];
+	bool ok = fread(header, sizeof(header), 1, in) == 1
+			&& header[0] == EQUITY_MAGIC && header[1] == EQUITY_VERSION && header[2] == NHANDS
+			&& fread(equity, sizeof(float), NHANDS*NHANDS, in) == NHANDS*NHANDS
+			&& fgetc(in) == EOF;
+	fclose(in);
+	if (!ok) return false;
+
+	bool loaded = false;
+	std::call_once(_tableOnce, [&loaded] (){
+		memcpy(_equity, equity, sizeof(_equity));
+		publishTable();
+		loaded = true;
+	});
+	return loaded;
+}
+
+bool
+saveClassEquities (const char* filename){
+	requireTable();
+	FILE* out = fopen(filename, "wb");
+	if (!out) return false;
+	unsigned int header[3] = {EQUITY_MAGIC, EQUITY_VERSION, NHANDS};
+	bool ok = fwrite(header, sizeof(header), 1, out) == 1
+			&& fwrite(_equity, sizeof(float), NHANDS*NHANDS, out) == NHANDS*NHANDS;
+	return (fclose(out) == 0) && ok;
+}
+
+float
+classEquity (int a, int b){
+	requireTable();
+	return _equity[a][b];
+}
+
+double
+rangeEquity (int hand, int k){
+	requireTable();
+	return _prefix[hand][k]/(rangeWeight(k)*NCOMBOS);
+}
+
+double
+rangeWeight (int k){
+	static const std::vector<int> combos = prefixCombos();
+	return combos[k]/(double) NCOMBOS;
+}
+
+/**
+ *  Portion of the deals weaker than a hand, counting half of its own class.
+ */
+static double
+dealStrength (int hand){
+	int k = top[hand/NRANKS][hand%NRANKS];
+	return 1 - (rangeWeight(k - 1) + rangeWeight(k))/2;
+}
+
+/**
+ *  Mean strength of a deal. It is 1/2, but summed so that rounding does not
+ *  bias dealLuck.
+ */
+static double
+meanDealStrength (){
+	double m = 0;
+	for (int h=0; h<NHANDS; h++)
+		m += handCombos(h)*dealStrength(h);
+	return m/NCOMBOS;
+}
+
+double
+dealLuck (int hand, int stack){
+	static const double mean = meanDealStrength();
+	return (dealStrength(hand) - mean)*stack;
+}
+
+/**
+ *  Combinations of every class left by a combination of every other one.
+ *  They do not depend on which combination was dealt.
+ */
+static std::vector<int>
+blockedCombos (){
+	std::vector<int> left(NHANDS*NHANDS, 0);
+	for (int d=0; d<NHANDS; d++){
+		int i = d/NRANKS, j = d%NRANKS;
+		int a = i, b = (i == j) ? CARDS_PER_SUIT + i : (i < j) ? j : CARDS_PER_SUIT + j;
+
+		for (int x=0; x<52; x++)
+			for (int y=x+1; y<52; y++)
+				if (x != a && x != b && y != a && y != b)
+					left[d*NHANDS + handToNumeric(Card(x), Card(y))]++;
+	}
+	return left;
+}
+
+int
+handCombos (int hand, int dealt){
+	static const std::vector<int> left = blockedCombos();
+	return left[dealt*NHANDS + hand];
+}
+
+DealValue::DealValue (const CompiledStrategy& sb, const CompiledStrategy& bb){
+	// Combinations left for the opponent once two cards are dealt.
+	const double left = 50*49/2;
+
+	for (int row=0; row<COMPILED_ROWS; row++){
+		// Chips won by each role, as a constant and a slope in the stack.
+		double (*vsb)[2] = _coef[0][row], (*vbb)[2] = _coef[1][row];
+		for (int h=0; h<NHANDS; h++)
+			vsb[h][0] = vsb[h][1] = vbb[h][0] = vbb[h][1] = 0;
+
+		for (int h=0; h<NHANDS; h++){
+			bool shove = sb.aggressive(PlayerRole::SB, row, h);
+			for (int g=0; g<NHANDS; g++){
+				bool call = bb.aggressive(PlayerRole::BB, row, g);
+				double n = handCombos(g, h)/left;
+				double m = handCombos(h, g)/left;
+
+				if (!shove){
+					vsb[h][0] -= n;
+					vbb[g][0] += m;
+				}
+				else if (!call){
+					vsb[h][0] += 2*n;
+					vbb[g][0] -= 2*m;
+				}
+				else {
+					double e = classEquity(h, g);
+					vsb[h][1] += n*(2*e - 1);
+					vbb[g][1] += m*(1 - 2*e);
+				}
+			}
+		}
+
+		for (int r=0; r<2; r++){
+			double (*v)[2] = _coef[r][row];
+			double mean[2] = {0, 0};
+			for (int h=0; h<NHANDS; h++){
+				mean[0] += handCombos(h)*v[h][0];
+				mean[1] += handCombos(h)*v[h][1];
+			}
+			for (int h=0; h<NHANDS; h++){
+				v[h][0] -= mean[0]/NCOMBOS;
+				v[h][1] -= mean[1]/NCOMBOS;
+			}
+		}
+	}
+}
+
+/**
+ *  Part of the cache of boardEquity.
+ */
+struct EquityShard {
+	std::mutex lock;
+	std::unordered_map<unsigned long long,float> entries;
+};
+
+static EquityShard _shards[EQUITY_SHARDS];
+static std::atomic<unsigned long int> _hits(0), _misses(0);
+
+/**
+ *  Returns the same key for every situation that can be turned into
+ *  another by permuting the suits: the smallest key among the 24
+ *  permutations. The board takes the 52 lowest bits and the sorted hole
+ *  cards the 12 highest ones.
+ */
+static unsigned long long
+canonicalKey (int a, int b, unsigned long long board){
+	unsigned long long best = ~0ULL;
+	int suit[4] = {0, 1, 2, 3};
+	do {
+		unsigned long long m = 0;
+		for (int s=0; s<4; s++)
+			m |= ((board >> (s*CARDS_PER_SUIT)) & 0x1fff) << (suit[s]*CARDS_PER_SUIT);
+
+		int x = suit[a/CARDS_PER_SUIT]*CARDS_PER_SUIT + a%CARDS_PER_SUIT;
+		int y = suit[b/CARDS_PER_SUIT]*CARDS_PER_SUIT + b%CARDS_PER_SUIT;
+		if (x > y) std::swap(x, y);
+
+		best = std::min(best, m | ((unsigned long long) (x*52 + y) << 52));
+	} while (std::next_permutation(suit, suit + 4));
+
+	return best;
+}
+
+static char*
+cardString (int id, char* str){
+	*str++ = ranks[id % CARDS_PER_SUIT];
+	*str++ = suits[id / CARDS_PER_SUIT];
+	return str;
+}
+
+float
+boardEquity (const Card* hand, unsigned long long board){
+	unsigned long long key = canonicalKey(hand[0].id(), hand[1].id(), board);
+	EquityShard& shard = _shards[(key*0x9e3779b97f4a7c15ULL) >> 58];
+
+	{
+		std::lock_guard<std::mutex> guard(shard.lock);
+		std::unordered_map<unsigned long long,float>::iterator it = shard.entries.find(key);
+		if (it != shard.entries.end()){
+			_hits.fetch_add(1, std::memory_order_relaxed);
+			return it->second;
+		}
+	}
+
+	// Evaluated without the lock. Two threads may evaluate the same
+	// situation at once, which is cheaper than making one wait.
+	char hands[8], com[11], *ptr = com;
+	*cardString(hand[1].id(), cardString(hand[0].id(), hands)) = ':';
+	strcpy(&hands[5], "xx");
+	for (unsigned long long m = board; m; m &= m - 1)
+		ptr = cardString(__builtin_ctzll(m), ptr);
+	*ptr = '\0';
+
+	Results* res = alloc_results();
+	calc(hands, com, "", EQUITY_ITER, res);
+	float equity = res->ev[0];
+	free_results(res);
+	_misses.fetch_add(1, std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> guard(shard.lock);
+	if (shard.entries.size() >= EQUITY_SHARD_ENTRIES) shard.entries.clear();
+	shard.entries[key] = equity;
+
+	return equity;
+}
+
+void
+boardEquityStats (unsigned long int* hits, unsigned long int* misses){
+	*hits = _hits.load(std::memory_order_relaxed);
+	*misses = _misses.load(std::memory_order_relaxed);
+}
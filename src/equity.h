@@ -0,0 +1,202 @@
+#ifndef _EQUITY_H_
+#define _EQUITY_H_
+
+#include "handutils.h"
+#include "card.h"
+#include "strategy.h"
+
+/**
+ *  @brief Number of Monte Carlo iterations used by boardEquity to evaluate
+ *  each situation.
+ */
+#define EQUITY_ITER 2000
+
+/**
+ *  @brief Number of shards of the cache of boardEquity. Each one has its own
+ *  lock, so threads seldom wait for each other.
+ */
+#define EQUITY_SHARDS 64
+
+/**
+ *  @brief Number of entries a shard may hold. A full shard is emptied
+ *  before inserting, which bounds the memory of the cache.
+ */
+#define EQUITY_SHARD_ENTRIES (1 << 16)
+
+/**
+ *  @brief Identifies a file of class equities written by saveClassEquities.
+ */
+#define EQUITY_MAGIC 0x5145434e
+#define EQUITY_VERSION 1
+
+/**
+ *  @brief Number of two card combinations in a deck.
+ */
+#define NCOMBOS 1326
+
+/**
+ *  @brief Returns the number of two card combinations of a hand class: 6 for
+ *  pairs, 4 for suited hands and 12 for offsuit ones.
+ *
+ *  @param hand Numeric representation of the hand.
+ */
+inline int
+handCombos (int hand){
+	int i = hand/NRANKS, j = hand%NRANKS;
+	return (i == j) ? 6 : (i < j) ? 4 : 12;
+}
+
+/**
+ *  @brief Returns the number of two card combinations of a hand class left
+ *  once a combination of another class has been dealt.
+ *
+ *  @param hand Numeric representation of the hand.
+ *  @param dealt Numeric representation of the class dealt.
+ */
+int
+handCombos (int hand, int dealt);
+
+/**
+ *  @brief Returns the share of the pot that a hand class wins all-in
+ *  preflop against another one, ties counting as a split.
+ *
+ *  @param a Numeric representation of the hand.
+ *  @param b Numeric representation of the opponent's hand.
+ *
+ *  Equities are exact: every board is enumerated for every pair of
+ *  combinations of the classes. The whole table is loaded with
+ *  loadClassEquities or, the first time it is needed, computed once, which
+ *  takes a while. Afterwards it is only read, without locks, so it is safe
+ *  and cheap to call from several threads.
+ */
+float
+classEquity (int a, int b);
+
+/**
+ *  @brief Loads the table of classEquity from a file written by
+ *  saveClassEquities, so that it does not have to be computed.
+ *
+ *  @return false if the file could not be read, does not start with the
+ *  header of a table of this version and size, or the table was already
+ *  loaded or computed.
+ */
+bool
+loadClassEquities (const char* filename);
+
+/**
+ *  @brief Writes the table of classEquity to a file, computing it first if
+ *  needed. The file starts with EQUITY_MAGIC, EQUITY_VERSION and NHANDS,
+ *  followed by the NHANDS x NHANDS equities.
+ *
+ *  @return false if the file could not be written.
+ */
+bool
+saveClassEquities (const char* filename);
+
+/**
+ *  @brief Returns the share of the pot that a hand class wins all-in
+ *  preflop against a range made of the %k strongest classes of the hand
+ *  ranking, weighted by their number of combinations.
+ *
+ *  @param hand Numeric representation of the hand.
+ *  @param k Number of classes in the range, between 1 and NHANDS.
+ *
+ *  It reads a table of prefix sums filled along with the one of
+ *  classEquity.
+ */
+double
+rangeEquity (int hand, int k);
+
+/**
+ *  @brief Returns the portion of the combinations of a deck that belong to
+ *  the %k strongest classes of the hand ranking.
+ */
+double
+rangeWeight (int k);
+
+/**
+ *  @brief Returns how much better than average a dealt hand is, scaled by
+ *  the effective stack. Its mean over random deals is 0 for any stack.
+ *
+ *  @param hand Numeric representation of the hand.
+ *  @param stack Effective stack of the hand.
+ *
+ *  The strength of a hand is the portion of the deals that are weaker than
+ *  it in the hand ranking. It is meant as a control variate of the result
+ *  of a hand: strong hands tend to win, and more so with deep stacks. It
+ *  does not depend on the players, so it is used when DealValue is not
+ *  available.
+ */
+double
+dealLuck (int hand, int stack);
+
+/**
+ *  @brief Value of the hand dealt to each player of a heads-up push/fold
+ *  hand, knowing both strategies.
+ *
+ *  The value of a deal is the chips the player expects to win with it:
+ *  the opponent's class is averaged with the combinations left by the deal,
+ *  and all-ins are scored with classEquity. Values are centred by their
+ *  mean over random deals, which is known exactly, so they make a control
+ *  variate of the result of a hand that is much closer to it than dealLuck.
+ *
+ *  Building it goes through every pair of classes for each row of the
+ *  strategies, which is cheap once per match. Afterwards luck() is a
+ *  lookup.
+ */
+class DealValue {
+public:
+	/**
+	 *  @brief Computes the values.
+	 *
+	 *  @param sb Strategy of the small blind.
+	 *  @param bb Strategy of the big blind.
+	 */
+	DealValue (const CompiledStrategy& sb, const CompiledStrategy& bb);
+
+	/**
+	 *  @brief Returns the centred value of a deal, in chips.
+	 *
+	 *  @param role PlayerRole of the player, SB or BB.
+	 *  @param hand Numeric representation of the hand dealt to the player.
+	 *  @param stack Effective stack of the hand.
+	 */
+	double
+	luck (int role, int hand, int stack) const {
+		const double* c = _coef[role != PlayerRole::SB][CompiledStrategy::row(stack)][hand];
+		return c[0] + c[1]*stack;
+	}
+
+private:
+	/**
+	 *  Decisions do not change within a row of the strategies, so the value
+	 *  is linear in the stack: a constant and a slope for each role, row and
+	 *  hand.
+	 */
+	double _coef[2][COMPILED_ROWS][NHANDS][2];
+};
+
+/**
+ *  @brief Returns the share of the pot that a hand wins at showdown against
+ *  a random hand, given the community cards dealt so far.
+ *
+ *  @param hand The two hole cards.
+ *  @param board Community cards, with bit i set for the card with
+ *  identifier i, as in GameView::board.
+ *
+ *  Results are cached for the rest of the program and shared by every
+ *  thread. Situations that only differ by a permutation of the suits share
+ *  one entry, so each equity is evaluated once per tournament instead of
+ *  once per decision.
+ */
+float
+boardEquity (const Card* hand, unsigned long long board);
+
+/**
+ *  @brief Returns the number of calls to boardEquity answered by the cache
+ *  and the number evaluated so far.
+ */
+void
+boardEquityStats (unsigned long int* hits, unsigned long int* misses);
+
+#endif
@@ -1,11 +1,16 @@
 #include "evolution.h"
+#include "pushfold.h"
 
-#define MAX_HANDS_PLAYED 100000
+#include <algorithm>
 
 void
-Tournament::simpleMatch (Player* p1, Player* p2){
+Tournament::simpleMatch (Player* p1, Player* p2, const MatchOptions& options){
 	if (!p1->equal(*p2)){
+		if (playPushFoldMatch(*p1,*p2,MAX_HANDS_PLAYED,false,NULL,false,options.observer,options.proposal)) return;
+
 		PokerGame g(*p1,*p2);
+		g.importanceSampling(options.proposal);
+		if (options.observer) g.attachObserver(options.observer);
 		g.playSeveralHands(MAX_HANDS_PLAYED);
 	} else {
 #ifdef DEBUGV
@@ -16,18 +21,26 @@ Tournament::simpleMatch (Player* p1, Player* p2){
 }
 
 void
-Tournament::repeatedMatch (Player* p1, Player* p2){
+Tournament::repeatedMatch (Player* p1, Player* p2, const MatchOptions& options){
 	for (int i=0; i<10;i++){
+		if (playPushFoldMatch(*p1,*p2,MAX_HANDS_PLAYED,false,NULL,false,options.observer,options.proposal)) continue;
+
 		PokerGame g(*p1,*p2);
+		g.importanceSampling(options.proposal);
+		if (options.observer) g.attachObserver(options.observer);
 		g.playSeveralHands(MAX_HANDS_PLAYED);
 	}
 }
 
 void
-Tournament::randomEffectiveStackMatch (Player* p1, Player* p2){
+Tournament::randomEffectiveStackMatch (Player* p1, Player* p2, const MatchOptions& options){
 	if (!p1->equal(*p2)){
+		if (playPushFoldMatch(*p1,*p2,MAX_HANDS_PLAYED,true,NULL,false,options.observer,options.proposal)) return;
+
 		PokerGame g(*p1,*p2);
 		g.randomEffectiveStack(true);
+		g.importanceSampling(options.proposal);
+		if (options.observer) g.attachObserver(options.observer);
 		g.playSeveralHands(MAX_HANDS_PLAYED);
 	} else {
 #ifdef DEBUGVV
@@ -37,9 +50,207 @@ Tournament::randomEffectiveStackMatch (Player* p1, Player* p2){
 	}
 }
 
+void
+Tournament::sequentialMatch (Player* p1, Player* p2, const MatchOptions& options){
+	if (p1->equal(*p2)) return;
+
+	SequentialTest test = SequentialTest::winner();
+	if (playPushFoldMatch(*p1,*p2,MAX_HANDS_PLAYED,true,&test,false,options.observer,options.proposal)) return;
+
+	PokerGame g(*p1,*p2);
+	g.randomEffectiveStack(true);
+	g.importanceSampling(options.proposal);
+	if (options.observer) g.attachObserver(options.observer);
+	g.playSeveralHands(MAX_HANDS_PLAYED,&test);
+}
+
+void
+Tournament::allInAdjustedMatch (Player* p1, Player* p2, const MatchOptions& options){
+	if (p1->equal(*p2)) return;
+
+	if (playPushFoldMatch(*p1,*p2,MAX_HANDS_PLAYED,true,NULL,true,options.observer,options.proposal)) return;
+
+	PokerGame g(*p1,*p2);
+	g.randomEffectiveStack(true);
+	g.allInAdjusted(true);
+	g.importanceSampling(options.proposal);
+	if (options.observer) g.attachObserver(options.observer);
+	g.playSeveralHands(MAX_HANDS_PLAYED);
+}
+
+void
+Tournament::playMatch (Match match, const MatchOptions& options, Player* p1, Player* p2){
+	RunningStats r1 = p1->results(), r2 = p2->results();
+	p1->matchStarted();
+	p2->matchStarted();
+	match(p1,p2,options);
+	p1->matchFinished(r1);
+	p2->matchFinished(r2);
+}
+
+void
+Tournament::cachedMatch (Match match, const MatchOptions& options, Player* p1, Player* p2,
+		MatchResult* result){
+	PlayerStats s1 = p1->stats(), s2 = p2->stats();
+	playMatch(match,options,p1,p2);
+
+	// Results are stored with the lower hash first, as in the key.
+	bool ordered = p1->hash() <= p2->hash();
+	(ordered ? result->first : result->second) = p1->stats().since(s1);
+	(ordered ? result->second : result->first) = p2->stats().since(s2);
+}
+
+void
+Tournament::credit (Player* p1, Player* p2, const MatchResult& result){
+	if (p1->hash() <= p2->hash()){
+		p1->credit(result.first);
+		p2->credit(result.second);
+	}
+	else {
+		p1->credit(result.second);
+		p2->credit(result.first);
+	}
+}
+
+void
+Tournament::record (Player* p1, Player* p2, MatchResult& result){
+	if (!_replicates) return;
+	if (result.draw < 0) result.draw = _draws++;
+
+	bool ordered = p1->hash() <= p2->hash();
+	MatchRecord r = {(ordered) ? p1 : p2, (ordered) ? p2 : p1,
+			{result.first.results, result.second.results}, result.draw};
+	_records.push_back(r);
+}
+
+void
+Tournament::launch (Schedule& s, Player* p1, Player* p2, MatchResult* result){
+	s.busy.insert(p1);
+	s.busy.insert(p2);
+
+	Match m = match();
+	MatchOptions options = _options;
+	s.group.run([this, &s, m, options, p1, p2, result] (){
+		if (result) cachedMatch(m,options,p1,p2,result);
+		else playMatch(m,options,p1,p2);
+
+		std::lock_guard<std::mutex> lock(s.mutex);
+		if (result){
+			result->played = true;
+			record(p1,p2,*result);
+		}
+		s.busy.erase(p1);
+		s.busy.erase(p2);
+		dispatch(s);
+	});
+}
+
+void
+Tournament::dispatch (Schedule& s){
+	std::list<std::pair<Player*,Player*> >::iterator it = s.pending.begin();
+	while (it != s.pending.end()){
+		Player* a = it->first;
+		Player* b = it->second;
+		if (s.busy.count(a) || s.busy.count(b)){
+			it++;
+			continue;
+		}
+
+		if (!_cacheMatches || !a->cacheable() || !b->cacheable()){
+			MatchResult* result = NULL;
+			if (_replicates){
+				s.uncached.push_back(MatchResult());
+				result = &s.uncached.back();
+				result->draw = -1;
+			}
+			launch(s,a,b,result);
+			it = s.pending.erase(it);
+			continue;
+		}
+
+		std::pair<unsigned long long,unsigned long long> key(
+				std::min(a->hash(), b->hash()), std::max(a->hash(), b->hash()));
+
+		MatchCache::iterator c = s.cache->find(key);
+		if (c == s.cache->end()){
+			MatchResult* result = &(*s.cache)[key];
+			result->played = false;
+			result->draw = -1;
+			launch(s,a,b,result);
+		}
+		else if (c->second.played){
+			credit(a,b,c->second);
+			record(a,b,c->second);
+		}
+		else
+			s.deferred.push_back(*it); // Being played.
+		it = s.pending.erase(it);
+	}
+}
+
+void
+Tournament::playMatches (const std::vector<std::pair<Player*,Player*> >& pairs,
+		MatchCache& cache){
+	Schedule s;
+	s.cache = &cache;
+	{
+		std::lock_guard<std::mutex> lock(s.mutex);
+		s.pending.assign(pairs.begin(), pairs.end());
+		dispatch(s);
+	}
+	s.group.wait();
+
+	for (std::vector<std::pair<Player*,Player*> >::iterator it = s.deferred.begin(); it != s.deferred.end(); it++){
+		unsigned long long ha = it->first->hash(), hb = it->second->hash();
+		MatchResult& result = cache[std::make_pair(std::min(ha,hb), std::max(ha,hb))];
+		credit(it->first, it->second, result);
+		record(it->first, it->second, result);
+	}
+}
+
+void
+Tournament::rankPlayers (const std::vector<Player*>& players){
+	std::map<Player*,int> index;
+	for (unsigned int i=0; i<players.size(); i++)
+		index[players[i]] = i;
+
+	RankingBootstrap bootstrap(players.size());
+	std::vector<bool> recorded(players.size(), false);
+	for (std::vector<MatchRecord>::iterator it = _records.begin(); it != _records.end(); it++){
+		std::map<Player*,int>::iterator a = index.find(it->first);
+		std::map<Player*,int>::iterator b = index.find(it->second);
+
+		if (a != index.end() && b != index.end()){
+			bootstrap.addMatch(a->second, b->second, it->results[0], it->results[1], it->draw);
+			recorded[a->second] = recorded[b->second] = true;
+		}
+		// Opponents from outside, such as copies, get no draw of their own.
+		else if (a != index.end()){
+			bootstrap.addMatch(a->second, -1, it->results[0]);
+			recorded[a->second] = true;
+		}
+		else if (b != index.end()){
+			bootstrap.addMatch(b->second, -1, it->results[1]);
+			recorded[b->second] = true;
+		}
+	}
+
+	for (unsigned int i=0; i<players.size(); i++)
+		if (!recorded[i])
+			bootstrap.addMatch(i, -1, players[i]->results());
+
+	bootstrap.run(_replicates, _confidence);
+	for (unsigned int i=0; i<players.size(); i++)
+		if (_replicates) players[i]->ranking(bootstrap.interval(i));
+
+	_records.clear();
+	_draws = 0;
+}
+
 void
 ConcurrentTournament::playTournament (const std::vector<Player*>& players){
-	std::vector<std::thread> threads;
+	MatchCache cache;
+	std::vector<std::pair<Player*,Player*> > pairs;
 
 	int m = players.size(), n, start;
 	(m % 2 == 0) ? (n=m, start=0) : (n = m+1, start=1);
@@ -48,14 +259,10 @@ ConcurrentTournament::playTournament (const std::vector<Player*>& players){
 			int a,b;
 			a = (i + (round-1)*n/2) % (n-1);
 			(i==0) ? b=n-1-i : b = (n-1-i + (round-1)*n/2) % (n-1);
-			//match(players.at(a), players.at(b));
-			threads.push_back(std::thread(match(),players.at(a),players.at(b)));
-		}
-		for (std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); it++) {
-			(*it).join();
+			pairs.push_back(std::make_pair(players.at(a),players.at(b)));
 		}
-		threads.clear();
 	}
+	playMatches(pairs, cache);
 
 #ifdef DEBUG
 	long int acc=0;
@@ -71,7 +278,8 @@ ConcurrentTournament::playTournament (const std::vector<Player*>& players){
 
 void
 ConcurrentTournamentWithCoin::playTournament (const std::vector<Player*>& players){
-	std::vector<std::thread> threads;
+	MatchCache cache;
+	std::vector<std::pair<Player*,Player*> > pairs;
 
 	int m = players.size(), n, start;
 	(m % 2 == 0) ? (n=m, start=0) : (n = m+1, start=1);
@@ -80,16 +288,11 @@ ConcurrentTournamentWithCoin::playTournament (const std::vector<Player*>& player
 			int a,b;
 			a = (i + (round-1)*n/2) % (n-1);
 			(i==0) ? b=n-1-i : b = (n-1-i + (round-1)*n/2) % (n-1);
-			//match(players.at(a), players.at(b));
-			if (GAFlipCoin(_p)){
-				threads.push_back(std::thread(match(),players.at(a),players.at(b)));
-			}
-		}
-		for (std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); it++) {
-			(*it).join();
+			if (GAFlipCoin(_p))
+				pairs.push_back(std::make_pair(players.at(a),players.at(b)));
 		}
-		threads.clear();
 	}
+	playMatches(pairs, cache);
 #ifdef DEBUG
 	long int acc=0;
 	bool nhandseq = true;
@@ -103,18 +306,134 @@ ConcurrentTournamentWithCoin::playTournament (const std::vector<Player*>& player
 
 void
 OneVsAllTournament::playTournament (const std::vector<Player*>& players){
-	std::vector<std::thread> threads;
+	MatchCache cache;
+	std::vector<std::pair<Player*,Player*> > pairs;
 	std::vector<Player*> copies;
 	for (std::vector<Player*>::const_iterator it = players.begin(); it!=players.end();it++){
 		copies.push_back(_opponent->clonePlayer());
-		threads.push_back(std::thread(match(),(*it),copies.back()));
+		pairs.push_back(std::make_pair(*it,copies.back()));
 	}
-	for (std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); it++)
-		(*it).join();
+	playMatches(pairs, cache);
 	for (std::vector<Player*>::iterator it = copies.begin(); it != copies.end(); it++)
 		delete *it;
 }
 
+void
+ReplayTournament::replayMatch (Player* p, Player* opponent,
+		const std::vector<HandRecord>* deals, bool mirrored, MatchOptions options){
+	RunningStats start = p->results();
+	p->matchStarted();
+	opponent->matchStarted();
+
+	PokerGame g(*p,*opponent);
+	if (options.observer) g.attachObserver(options.observer);
+	g.replayHands(*deals);
+
+	if (mirrored){
+		PokerGame m(*opponent,*p);
+		if (options.observer) m.attachObserver(options.observer);
+		m.replayHands(*deals);
+	}
+	p->matchFinished(start);
+}
+
+void
+ReplayTournament::playTournament (const std::vector<Player*>& players){
+	TaskGroup group;
+	std::vector<Player*> copies;
+	for (std::vector<Player*>::const_iterator it = players.begin(); it!=players.end();it++){
+		copies.push_back(_opponent->clonePlayer());
+		group.run(std::bind(replayMatch,(*it),copies.back(),_deals,_mirrored,_options));
+	}
+	group.wait();
+	for (std::vector<Player*>::iterator it = copies.begin(); it != copies.end(); it++)
+		delete *it;
+}
+
+void
+RacingTournament::raceMatches (Player* p, std::vector<Player*>* opponents, int hands,
+		bool randomEffectiveStack, MatchOptions options){
+	for (std::vector<Player*>::iterator it = opponents->begin(); it != opponents->end(); it++){
+		RunningStats start = p->results();
+		p->matchStarted();
+		(*it)->matchStarted();
+		if (!playPushFoldMatch(*p,**it,hands,randomEffectiveStack,NULL,false,options.observer,options.proposal)){
+			PokerGame g(*p,**it);
+			g.randomEffectiveStack(randomEffectiveStack);
+			g.importanceSampling(options.proposal);
+			if (options.observer) g.attachObserver(options.observer);
+			g.playSeveralHands(hands);
+		}
+		p->matchFinished(start);
+		delete *it;
+	}
+}
+
+/**
+ *  Orders players from the best to the worst score.
+ */
+static bool
+betterScore (Player* a, Player* b){
+	return a->ev() > b->ev();
+}
+
+bool
+RacingTournament::eliminate (std::vector<Player*>& contenders) const {
+	if ((int) contenders.size() <= _top) return true;
+
+	std::sort(contenders.begin(), contenders.end(), betterScore);
+
+	// Lower bound of the last player in the top.
+	Player* last = contenders[_top - 1];
+	double bound = last->ev() - last->evHalfWidth(_z);
+
+	int keep = _top;
+	for (int i=_top; i<(int) contenders.size(); i++){
+		Player* p = contenders[i];
+		if (p->ev() + p->evHalfWidth(_z) >= bound)
+			contenders[keep++] = p;
+	}
+	contenders.resize(keep);
+
+	// Resolved when nobody outside the top can reach it any more.
+	return keep == _top;
+}
+
+void
+RacingTournament::playTournament (const std::vector<Player*>& players){
+	std::vector<Player*> contenders(players);
+	int hands = _initialHands, played = 0;
+	_stages = 0;
+
+	while (!contenders.empty() && played < _maxHands){
+		hands = std::min(hands, _maxHands - played);
+
+		// The opponents are copied before any match starts, since the
+		// contenders change while they play.
+		std::vector<std::vector<Player*> > opponents(contenders.size());
+		for (unsigned int i=0; i<contenders.size(); i++)
+			for (std::vector<Player*>::const_iterator it = players.begin(); it != players.end(); it++)
+				if (!contenders[i]->equal(**it))
+					opponents[i].push_back((*it)->clonePlayer());
+
+		TaskGroup group;
+		for (unsigned int i=0; i<contenders.size(); i++)
+			group.run(std::bind(raceMatches,contenders[i],&opponents[i],hands,_randomEffectiveStack,
+					_options));
+		group.wait();
+
+		played += hands;
+		hands *= 2;
+		_stages++;
+
+		if (eliminate(contenders)) break;
+	}
+
+	_hands = 0;
+	for (std::vector<Player*>::const_iterator it = players.begin(); it != players.end(); it++)
+		_hands += (*it)->hands_played();
+}
+
 void
 ResultsReader::read (){
 	int nPlayers;
@@ -337,10 +656,14 @@ void PlayersEvaluator(GAPopulation& pop){
 
 	Tournament& tournament = (Tournament&) *reinterpret_cast<Tournament*>(pop.userData());
 	tournament.playTournament(players);
+	if (tournament.bootstrapReplicates())
+		tournament.rankPlayers(players);
 
 	char desc[MAX_PLAYER_DESC];
 	for (int i=0; i<pop.size(); i++){
-		pop.individual(i).score(players.at(i)->ev());
+		const RankingInterval& r = players.at(i)->ranking();
+		pop.individual(i).score((tournament.lowerBoundScores() && r.replicates) ?
+				r.scoreLower : players.at(i)->matchEv());
 #ifdef DEBUG
 #ifdef DEBUGV
 		printf("(%s) - %f \n", players.at(i)->desc(desc), pop.individual(i).score());
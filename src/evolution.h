@@ -10,12 +10,25 @@
 #include <random>
 #include <cmath>
 #include <vector>
+#include <map>
+#include <set>
+#include <list>
+#include <utility>
+#include <algorithm>
 
 #include <ga/ga.h>
 
 #include "gnuplot-iostream.h"
 
 #include "player.h"
+#include "game.h"
+#include "library.h"
+#include "threadpool.h"
+
+/**
+ *  @brief Number of hands of each match of the tournaments.
+ */
+#define MAX_HANDS_PLAYED 100000
 
 void match(Player* p1, Player* p2);
 void normalMatch(Player* p1, Player* p2);
@@ -35,6 +48,23 @@ void experimentAES();*/
 //void evolve(GAGeneticAlgorithm& ga);
 
 
+/**
+ *  @brief Settings of a tournament passed to every match it plays.
+ */
+struct MatchOptions {
+	/**
+	 *  @brief Notified of every hand played, NULL for none. It is shared by
+	 *  the matches running at the same time, like a HandHistoryRecorder.
+	 */
+	GameObserver* observer;
+
+	/**
+	 *  @brief Proposal the first seat's hand and the effective stack are
+	 *  dealt from, NULL to deal them uniformly. See DealProposal.
+	 */
+	const DealProposal* proposal;
+};
+
 /**
  *  @brief Abstract class for a tournament of players.
  */
@@ -45,28 +75,53 @@ public:
 	 *  @brief Creates the tournament.
 	 */
 	Tournament () :
-		_match(simpleMatch) {}
+		_match(simpleMatch),
+		_cacheMatches(true),
+		_replicates(0),
+		_confidence(0.95),
+		_lowerBoundScores(false),
+		_draws(0) {
+		_options.observer = NULL;
+		_options.proposal = NULL;
+	}
 
-	typedef void (*Match) (Player*,Player*);
+	typedef void (*Match) (Player*,Player*,const MatchOptions&);
 
 	/**
 	 *  @brief Matches two players one single time.
 	 */
 	static void
-	simpleMatch (Player* p1, Player* p2);
+	simpleMatch (Player* p1, Player* p2, const MatchOptions& options);
 
 	/**
 	 *  @brief Matches two players several times.
 	 */
 	static void
-	repeatedMatch (Player* p1, Player* p2);
+	repeatedMatch (Player* p1, Player* p2, const MatchOptions& options);
 
 	/**
 	 *  @brief Matches two players one single time. Effective
 	 *  stack is chosen randomly in each hand.
 	 */
 	static void
-	randomEffectiveStackMatch (Player* p1, Player* p2);
+	randomEffectiveStackMatch (Player* p1, Player* p2, const MatchOptions& options);
+
+	/**
+	 *  @brief Same as randomEffectiveStackMatch, but stops as soon as the
+	 *  winner is known, as told by SequentialTest::winner(). Lopsided
+	 *  pairings end after a few thousand hands instead of MAX_HANDS_PLAYED.
+	 *  Players are scored by Player::matchEv(), so those pairings count as
+	 *  much as the long ones.
+	 */
+	static void
+	sequentialMatch (Player* p1, Player* p2, const MatchOptions& options);
+
+	/**
+	 *  @brief Same as randomEffectiveStackMatch, but players are scored by
+	 *  the expected result of their all-ins instead of the chips they won.
+	 */
+	static void
+	allInAdjustedMatch (Player* p1, Player* p2, const MatchOptions& options);
 
 	/**
 	 *  @brief Destructor.
@@ -99,10 +154,184 @@ public:
 	Match
 	match () const { return _match; }
 
+	/**
+	 *  @brief Notifies an observer, such as a HandHistoryRecorder, of every
+	 *  hand played by the tournament. Pairings credited with a cached result
+	 *  are not played again, so their hands are only recorded once. NULL
+	 *  detaches it.
+	 */
+	void
+	recordHands (GameObserver* observer) { _options.observer = observer; }
+
+	/**
+	 *  @brief Returns the settings passed to every match.
+	 */
+	const MatchOptions&
+	options () const { return _options; }
+
+	/**
+	 *  @brief Deals every match from a proposal, as
+	 *  PokerGame::importanceSampling(), so that the hand classes and stacks
+	 *  it favours weigh more in the scores of the players. Results stay
+	 *  unbiased. NULL deals uniformly again. The proposal must outlive the
+	 *  tournament and its clones.
+	 */
+	void
+	importanceSampling (const DealProposal* proposal) { _options.proposal = proposal; }
+
+	/**
+	 *  @brief Enables reusing the result of a match for every later pairing of
+	 *  players identical to those ones, as told by Player::hash(). Matches of
+	 *  players that are not Player::cacheable() are always played. It is
+	 *  enabled by default.
+	 */
+	void
+	cacheMatches (bool b) { _cacheMatches = b; }
+
+	/**
+	 *  @brief Enables the bootstrap of the scores and ranks of the players
+	 *  done by rankPlayers(). Matches are recorded as they are played.
+	 *
+	 *  @param replicates Number of replicates, 0 disables it.
+	 *  @param confidence Confidence level of the intervals.
+	 *  @param lowerBoundScores Whether PlayersEvaluator scores players by
+	 *  the lower bound of their score instead of Player::matchEv().
+	 */
+	void
+	bootstrap (int replicates, double confidence = 0.95, bool lowerBoundScores = false) {
+		_replicates = replicates;
+		_confidence = confidence;
+		_lowerBoundScores = lowerBoundScores;
+	}
+
+	/**
+	 *  @brief Returns the number of replicates of the bootstrap, 0 if it is
+	 *  disabled.
+	 */
+	int
+	bootstrapReplicates () const { return _replicates; }
+
+	/**
+	 *  @brief Returns true if players are scored by the lower bound of their
+	 *  score.
+	 */
+	bool
+	lowerBoundScores () const { return _lowerBoundScores; }
+
+	/**
+	 *  @brief Computes the bootstrap intervals of the score and the rank of
+	 *  each player from the matches recorded, and sets them with
+	 *  Player::ranking(). The records are cleared afterwards.
+	 *
+	 *  Players without recorded matches, such as those of tournaments that
+	 *  do not play rounds, take part with all their results.
+	 *
+	 *  @param players Participants of the last tournament.
+	 */
+	void
+	rankPlayers (const std::vector<Player*>& players);
 
 protected:
+	/**
+	 *  @brief What each player of a match gained from it.
+	 */
+	struct MatchResult {
+		PlayerStats first, second;
+		bool played;
+
+		/**
+		 *  @brief Bootstrap draw of the match, shared by every pairing
+		 *  credited with it. -1 until recorded.
+		 */
+		int draw;
+	};
+
+	/**
+	 *  @brief Results of each player of a pairing, recorded for the
+	 *  bootstrap. The first player has the lower hash.
+	 */
+	struct MatchRecord {
+		Player* first;
+		Player* second;
+		RunningStats results[2];
+		int draw;
+	};
+
+	/**
+	 *  @brief Results of the matches played so far, keyed by the hashes of
+	 *  both players in increasing order.
+	 */
+	typedef std::map<std::pair<unsigned long long,unsigned long long>, MatchResult> MatchCache;
+
+	/**
+	 *  @brief Plays a set of matches in the shared ThreadPool.
+	 *
+	 *  A player takes part in one match at a time. Matches are started in
+	 *  the order given as soon as both of their players are free, so there
+	 *  are no rounds to wait for: long matches do not hold back players
+	 *  that are done.
+	 *
+	 *  If caching is enabled, a pairing identical to one already in %cache
+	 *  is not played: its players are credited with the stored result.
+	 *
+	 *  @param pairs Players facing each other.
+	 *  @param cache Results of the tournament so far. It is updated.
+	 */
+	void
+	playMatches (const std::vector<std::pair<Player*,Player*> >& pairs, MatchCache& cache);
+
 	Match _match;
+	MatchOptions _options;
+	bool _cacheMatches;
+
+	int _replicates;
+	double _confidence;
+	bool _lowerBoundScores;
 
+private:
+	/**
+	 *  Matches of a call to playMatches() not over yet, guarded by %mutex.
+	 */
+	struct Schedule {
+		std::list<std::pair<Player*,Player*> > pending;
+		std::set<Player*> busy;
+		std::vector<std::pair<Player*,Player*> > deferred;
+		std::list<MatchResult> uncached;
+		MatchCache* cache;
+
+		std::mutex mutex;
+		TaskGroup group;
+	};
+
+	/**
+	 *  Starts the pending matches whose players are free. %s.mutex must be
+	 *  held.
+	 */
+	void
+	dispatch (Schedule& s);
+
+	void
+	launch (Schedule& s, Player* p1, Player* p2, MatchResult* result);
+
+	void
+	record (Player* p1, Player* p2, MatchResult& result);
+
+	std::vector<MatchRecord> _records;
+	int _draws;
+
+	/**
+	 *  Plays a match between events telling both players that it started
+	 *  and ended.
+	 */
+	static void
+	playMatch (Match match, const MatchOptions& options, Player* p1, Player* p2);
+
+	static void
+	cachedMatch (Match match, const MatchOptions& options, Player* p1, Player* p2,
+			MatchResult* result);
+
+	static void
+	credit (Player* p1, Player* p2, const MatchResult& result);
 };
 
 /**
@@ -216,6 +445,166 @@ private:
 	Player* _opponent;
 };
 
+/**
+ *  @brief Tournament of players in which every player faces one single foe on
+ *  a fixed set of recorded deals.
+ *
+ *  No deck is shuffled and recorded showdowns are reused whenever the same
+ *  players reach them, so thousands of candidates can be scored on the same
+ *  large deal set cheaply and without deal luck between them. Since the deals
+ *  are recorded, a proposal set with importanceSampling() is not used.
+ */
+class ReplayTournament : public Tournament {
+public:
+	/**
+	 *  @brief Constructs the tournament.
+	 *
+	 *  @param opponent The player which will face all the other players.
+	 *  @param deals Recorded deals. The vector is not copied and must outlive
+	 *  the tournament.
+	 *  @param mirrored If true every deal is played twice, once from each seat.
+	 */
+	ReplayTournament (const Player& opponent, const std::vector<HandRecord>& deals,
+			bool mirrored = true) :
+		_opponent(opponent.clonePlayer()),
+		_deals(&deals),
+		_mirrored(mirrored) {}
+
+	/**
+	 *  @brief Copy constructor.
+	 */
+	ReplayTournament (const ReplayTournament& other) :
+		_opponent(other._opponent->clonePlayer()),
+		_deals(other._deals),
+		_mirrored(other._mirrored) {}
+
+	/**
+	 *  @brief Assignement operator.
+	 */
+	ReplayTournament&
+	operator= (const ReplayTournament& other){
+		if (this == &other) return *this;
+
+		delete _opponent;
+		_opponent = other._opponent->clonePlayer();
+		_deals = other._deals;
+		_mirrored = other._mirrored;
+		return *this;
+	}
+
+	/**
+	 *  @brief Destructor.
+	 */
+	~ReplayTournament () { delete _opponent; }
+
+	/**
+	 *  @brief Replays the deals for every player against the opponent passed
+	 *  in the constructor.
+	 *
+	 *  @param players Contestants.
+	 */
+	void
+	playTournament (const std::vector<Player*>& players);
+
+	/**
+	 *  @brief Clones the tournament.
+	 */
+	Tournament*
+	clone () const { return new ReplayTournament(*this); }
+
+private:
+	static void
+	replayMatch (Player* p, Player* opponent, const std::vector<HandRecord>* deals,
+			bool mirrored, MatchOptions options);
+
+	Player* _opponent;
+	const std::vector<HandRecord>* _deals;
+	bool _mirrored;
+};
+
+/**
+ *  @brief Tournament that spends its hands on the players that may still
+ *  reach the top of the ranking.
+ *
+ *  It goes in stages. In each one, every contender plays a match against a
+ *  copy of every player of the population, so all of them estimate the same
+ *  thing: their result against the whole field. Contenders whose confidence
+ *  interval lies below that of the %top-th best are dropped and keep the
+ *  score they had, and the next stage gives twice as many hands to those
+ *  left. It stops when the top is resolved or the matches reach %maxHands
+ *  in total.
+ *
+ *  The match set with Tournament::match() is not used, nor the match cache.
+ */
+class RacingTournament : public Tournament {
+public:
+	/**
+	 *  @brief Constructs the tournament.
+	 *
+	 *  @param top Number of players whose ranking matters, at least 1.
+	 *  @param initialHands Hands of each match in the first stage, at least
+	 *  1.
+	 *  @param maxHands Hands of each pairing summed over every stage.
+	 *  @param z Normal quantile of the confidence intervals.
+	 *  @param randomEffectiveStack Whether the effective stack is drawn in
+	 *  each hand.
+	 */
+	RacingTournament (int top = 1, int initialHands = 2000, int maxHands = MAX_HANDS_PLAYED,
+			double z = STATS_Z95, bool randomEffectiveStack = true) :
+		_top(std::max(top, 1)),
+		_initialHands(std::max(initialHands, 1)),
+		_maxHands(maxHands),
+		_z(z),
+		_randomEffectiveStack(randomEffectiveStack),
+		_hands(0),
+		_stages(0) {}
+
+	/**
+	 *  @brief Races the players.
+	 *
+	 *  @param players Participants of the tournament.
+	 */
+	void
+	playTournament (const std::vector<Player*>& players);
+
+	/**
+	 *  @brief Clones the tournament.
+	 */
+	Tournament*
+	clone () const { return new RacingTournament(*this); }
+
+	/**
+	 *  @brief Returns the number of hands played by the contenders in the
+	 *  last tournament.
+	 */
+	unsigned long int
+	hands () const { return _hands; }
+
+	/**
+	 *  @brief Returns the number of stages of the last tournament.
+	 */
+	int
+	stages () const { return _stages; }
+
+private:
+	static void
+	raceMatches (Player* p, std::vector<Player*>* opponents, int hands,
+			bool randomEffectiveStack, MatchOptions options);
+
+	/**
+	 *  Drops the contenders that can no longer reach the top. Returns true
+	 *  if the top is resolved.
+	 */
+	bool
+	eliminate (std::vector<Player*>& contenders) const;
+
+	int _top, _initialHands, _maxHands;
+	double _z;
+	bool _randomEffectiveStack;
+
+	unsigned long int _hands;
+	int _stages;
+};
 
 //extern bool term;
 //void evolve (GAGeneticAlgorithm& ga);
@@ -365,6 +754,50 @@ private:
 };
 
 
+/**
+ *  @brief Adds every player of an algorithm output to a strategy library,
+ *  tagged with the generation and its score. Attached to a ResultsReader it
+ *  converts the output of a ResultsWriter.
+ *
+ *  The library is written when the recorder is destroyed.
+ */
+class LibraryRecorder: public EvolutionObserver {
+public:
+	/**
+	 *  @brief Constructs the recorder.
+	 *
+	 *  @param out Output stream where the library will be placed.
+	 *  @param run Identifier of the run, stored along with every strategy.
+	 */
+	LibraryRecorder(ostream& out, unsigned int run) :
+			_o(out), _run(run), _generation(0) {}
+
+	~LibraryRecorder() { _writer.write(_o); }
+
+	/**
+	 *  Event. Inherited from EvolutionObserver. Counts the generation.
+	 */
+	void generationCreated() { _generation++; }
+
+	/**
+	 *  Event. Inherited from EvolutionObserver. Adds the player to the library.
+	 */
+	void playerGenerated(Player* p) {
+		_writer.add(*p, _run, _generation, p->ev());
+	}
+
+	/**
+	 *  Event. Inherited from EvolutionObserver. Nothing to do in this case.
+	 */
+	void generationFinished() {}
+
+private:
+	StrategyLibraryWriter _writer;
+
+	ostream& _o;
+	unsigned int _run, _generation;
+};
+
 /**
  *  @brief Prints the output of a genetic algorithm.
  */
@@ -377,11 +810,18 @@ public:
 		printf("Generation achieved\n");
 	}
 	/**
-	 * Event. Prints information about the new user added to the population.
+	 * Event. Prints information about the new user added to the population,
+	 * with the 95% confidence interval of its score, or the bootstrap
+	 * intervals of its score and rank if they were computed.
 	 */
 	void playerGenerated(Player* p) {
 		char* desc = new char[MAX_PLAYER_DESC];
-		printf("(%s) - %f \n", p->desc(desc), p->ev());
+		const RankingInterval& r = p->ranking();
+		if (r.replicates)
+			printf("(%s) - %f [%f, %f] rank %d-%d \n", p->desc(desc), p->ev(),
+					r.scoreLower, r.scoreUpper, r.rankBest, r.rankWorst);
+		else
+			printf("(%s) - %f +/- %f \n", p->desc(desc), p->ev(), p->evHalfWidth());
 		delete desc;
 	}
 	/**
@@ -715,6 +1155,20 @@ public:
 		return *_tournament;
 	}
 
+	/**
+	 *  @brief Records every hand played by the evolution, as
+	 *  Tournament::recordHands().
+	 */
+	void
+	recordHands (GameObserver* observer) { _tournament->recordHands(observer); }
+
+	/**
+	 *  @brief Deals the matches of the evolution from a proposal, as
+	 *  Tournament::importanceSampling().
+	 */
+	void
+	importanceSampling (const DealProposal* proposal) { _tournament->importanceSampling(proposal); }
+
 	/**
 	 *  @brief Sets the number of players in the population.
 	 */
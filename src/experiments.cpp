@@ -10,22 +10,62 @@
 #define PLOTTING
 
 #include "evolution.h"
+#include "sweep.h"
+#include "external.h"
+#include "server.h"
+#include "equity.h"
+#include "sampling.h"
 
 void ExperimentRCEquilibrium(int n);
 void ExperimentRCAdaptative(int n);
 void ExperimentRCTEquilibrium(int n);
 void ExperimentRCTAdaptative(int);
 void ExperimentRCTRandomEffectiveStack();
+void ExperimentMixedEquilibrium(int n);
 double ExperimentOneVsOne (const Player&, const Player&);
+void ExperimentStackSweep (const Player&, const Player&);
+void ExperimentChartDatabase (const char*, const Player&);
+void ExperimentExternalBot (const char*, int);
+void ExperimentDecisionServer (const char*, const char*);
+void ExperimentPostflopEquilibrium (int n);
+void ExperimentSequentialMatch (const Player&, const Player&);
+void ExperimentImportanceSampling (const Player&, const Player&, double);
+void ExperimentRacing (int n);
+void ExperimentBreakdown (const Player&, const Player&);
 
 void readfile (const char*, const Player&);
 
+/**
+ *  @brief File where the exact table of class equities is kept between runs,
+ *  since it takes a while to compute. It is relative to the working
+ *  directory.
+ */
+#define CLASS_EQUITY_FILE "classequity.bin"
+
 int
 main () {
+	if (loadClassEquities(CLASS_EQUITY_FILE))
+		printf("Class equities read from %s\n", CLASS_EQUITY_FILE);
+	else {
+		printf("Computing class equities, to be saved in %s\n", CLASS_EQUITY_FILE);
+		if (!saveClassEquities(CLASS_EQUITY_FILE))
+			printf("Could not write %s\n", CLASS_EQUITY_FILE);
+	}
+
 //	ExperimentRCEquilibrium(20);
 //	ExperimentRCTAdaptative(20);
 //	ExperimentRCTEquilibrium(100);
 //	ExperimentRCTRandomEffectiveStack();
+//	ExperimentMixedEquilibrium(100);
+//	ExperimentStackSweep(RCTPlayer(0.70,0.37),PlayerNash());
+//	ExperimentChartDatabase("charts.db",RCTPlayer(0.70,0.37));
+//	ExperimentExternalBot("./mockbot 0.5",20);
+//	ExperimentDecisionServer("strategies.lib","/tmp/nlhe.sock");
+//	ExperimentPostflopEquilibrium(20);
+//	ExperimentSequentialMatch(RCTPlayer(0.70,0.37),PlayerAlwaysIn());
+//	ExperimentImportanceSampling(RCTPlayer(0.70,0.37),PlayerNash(),10);
+//	ExperimentRacing(20);
+//	ExperimentBreakdown(RCTPlayer(0.70,0.37),PlayerNash());
 	ExperimentOneVsOne(PlayerRaiseFoldPercent(0.58,0.37),RCTPlayer(0.70,0.37));
 
 	//readfile("rc1.dat", RCPlayer());
@@ -441,6 +481,56 @@ void ExperimentRCTRandomEffectiveStack (){
 	ExperimentOneVsOne(best,opp);
 }
 
+/**
+ *  @brief Evolve mixed strategy players to an equilibrium solution. Every
+ *  effective stack is played, so each layer of the genome is exercised.
+ */
+void ExperimentMixedEquilibrium (int n){
+	/*
+	 * Configure the player
+	 */
+	MixedPlayer genome;
+	// Start from pure strategies with different raise,call ranges.
+	genome.initializer(MixedPlayer::raiseCallInitializer);
+
+	int nPlayers = n;
+	int nGenerations = 10000;
+
+	/*
+	 * Set up the algorithm.
+	 */
+	PlayerEvolver evolver(genome,nPlayers);
+
+	ConcurrentTournament tournament;
+	tournament.match(Tournament::randomEffectiveStackMatch);
+	evolver.tournament(tournament);
+
+	Console console;
+	evolver.attachObserver(&console);
+
+	/*
+	 * Write results to disc.
+	 */
+	char filename[] = "mixede.dat";
+	std::ofstream out(filename, ios::binary | ios::trunc);
+	ResultsWriter writer(out,nPlayers);
+	evolver.attachObserver(&writer);
+
+	evolver.geneticAlgorithm().elitist(GABoolean::gaFalse);
+	evolver.geneticAlgorithm().nGenerations(nGenerations);
+
+	evolver.evolve();
+
+	//Print results
+	MixedPlayer& best = dynamic_cast<MixedPlayer&>(evolver.best());
+	char desc[MAX_PLAYER_DESC];
+	printf("Best player: %s\n", best.desc(desc));
+
+	//Check results
+	PlayerNash opp;
+	ExperimentOneVsOne(best,opp);
+}
+
 /**
  *  @brief Experiment to match two players and analyze their performance.
  */
@@ -463,7 +553,9 @@ double ExperimentOneVsOne (const Player& p1, const Player& p2) {
 		printf("Match %d\n", i);
 		printf("-----------------------------------------------------\n");
 		printf("Hands played: %d\n", player1->hands_played());
-		printf("Player 1 performance: %.2f bb/hands\n", player1->ev()*100);
+		printf("Player 1 performance: %.2f +/- %.2f bb/hands\n", player1->ev()*100, player1->evHalfWidth()*100);
+		printf("Player 1 luck corrected: %.2f +/- %.2f bb/hands\n", player1->controlledEv()*100,
+				player1->controlledEvError()*STATS_Z95*100);
 		printf("Player 1 raised: %.2f%%, Player 2 raised: %.2f%%\n", player1->raised()*100, player2->raised()*100);
 		printf("Player 1 called: %.2f%%, Player 2 called: %.2f%%\n", player1->called()*100, player2->called()*100);
 		printf("-----------------------------------------------------\n");
@@ -475,6 +567,282 @@ double ExperimentOneVsOne (const Player& p1, const Player& p2) {
 	return mean;
 }
 
+/**
+ *  @brief Experiment to see how the performance of a player against another
+ *  changes with the effective stack.
+ */
+void ExperimentStackSweep (const Player& p1, const Player& p2) {
+	Player* player1 = p1.clonePlayer();
+	Player* player2 = p2.clonePlayer();
+
+	StackSweep sweep(*player1,*player2);
+	sweep.play(100000);
+
+	printf("Hands played: %lu\n", sweep.hands_played());
+	printf("Stack   Player 1 (bb/hands)\n");
+	for (int s=SWEEP_MIN_STACK; s<=SWEEP_MAX_STACK; s++)
+		printf("%5d   %.2f\n", s, sweep.ev(0,s)*100);
+
+	delete player1;
+	delete player2;
+}
+
+/**
+ *  @brief Experiment to match a player against the equilibrium chart of the
+ *  blind structure played by the engine. If the database does not exist it
+ *  is built from the charts of PlayerNash, which stop at a stack of 20.
+ */
+void ExperimentChartDatabase (const char* filename, const Player& p) {
+	ChartDatabase* db = new ChartDatabase(filename);
+	if (!db->valid()){
+		delete db;
+
+		ChartDatabaseWriter writer;
+		ChartStructure structure = {1, 2, 0};
+		writer.addMaxStacks(structure, &sb_max_stack[0][0], &bb_max_stack[0][0]);
+		std::ofstream out(filename,ios::binary);
+		writer.write(out);
+		out.close();
+
+		db = new ChartDatabase(filename);
+	}
+
+	PlayerNashChart nash(*db);
+	if (nash.valid())
+		ExperimentOneVsOne(p, nash);
+	else
+		printf("%s has no chart for the 1/2 structure\n", filename);
+
+	delete db;
+}
+
+/**
+ *  @brief Evolve RCT players by matching them against a bot running in
+ *  another process. The decisions of every match of a generation are sent
+ *  to the bot in shared batches.
+ */
+void ExperimentExternalBot (const char* command, int n) {
+	ExternalBot bot(command);
+	if (!bot.valid()){
+		printf("Could not start %s\n", command);
+		return;
+	}
+
+	RCTPlayer genome;
+	genome.initializer(RCTPlayer::raiseCallInitializer);
+
+	PlayerEvolver evolver(genome,n);
+
+	ExternalPlayer opp(bot);
+	OneVsAllTournament tournament(opp);
+	evolver.tournament(tournament);
+
+	Console console;
+	evolver.attachObserver(&console);
+
+	evolver.geneticAlgorithm().elitist(GABoolean::gaTrue);
+	evolver.geneticAlgorithm().nGenerations(10);
+
+	time_t start = time(NULL);
+	evolver.evolve();
+	time_t end = time(NULL);
+
+	RCTPlayer& best = dynamic_cast<RCTPlayer&>(evolver.best());
+	char desc[MAX_PLAYER_DESC];
+	printf("Best player: %s\n", best.desc(desc));
+	printf("Elapsed time: %f min.\n", (end-start)/60.0);
+	printf("Decisions: %lu, round trips: %lu\n", bot.decisions(), bot.batches());
+}
+
+/**
+ *  @brief Serves the strategies of a library and measures the server with
+ *  the load generator, for several batch sizes.
+ */
+void ExperimentDecisionServer (const char* library, const char* socket) {
+	StrategyLibrary lib(library);
+	if (!lib.valid()){
+		printf("Could not open %s\n", library);
+		return;
+	}
+
+	DecisionServer server(socket);
+	if (!server.valid()){
+		printf("Could not bind %s\n", socket);
+		return;
+	}
+	StrategyTable* table = new StrategyTable(lib);
+	int n = table->size();
+	server.publish(table);
+	server.start();
+
+	printf("Strategies: %d\n", n);
+	printf("Batch   Queries/s   p50 (us)   p99 (us)   max (us)\n");
+	for (int batch=1; batch<=1024; batch*=4){
+		LoadReport r = generateLoad(socket, 4, 20000, batch, n);
+		printf("%5d   %9.0f   %8.1f   %8.1f   %8.1f\n", batch, r.throughput, r.p50, r.p99, r.max);
+	}
+
+	server.stop();
+}
+
+/**
+ *  @brief Experiment to evolve players that bet after the flop according to
+ *  the equity of their hands. Reports how many equities the cache saved.
+ */
+void ExperimentPostflopEquilibrium (int n){
+	PostflopPlayer genome;
+
+	PlayerEvolver evolver(genome,n);
+
+	ConcurrentTournament tournament;
+	tournament.match(Tournament::randomEffectiveStackMatch);
+	evolver.tournament(tournament);
+
+	Console console;
+	evolver.attachObserver(&console);
+
+	evolver.geneticAlgorithm().elitist(GABoolean::gaTrue);
+	evolver.geneticAlgorithm().nGenerations(100);
+
+	time_t start = time(NULL);
+	evolver.evolve();
+	time_t end = time(NULL);
+
+	PostflopPlayer& best = dynamic_cast<PostflopPlayer&>(evolver.best());
+	char desc[MAX_PLAYER_DESC];
+	printf("Best player: %s\n", best.desc(desc));
+	printf("Elapsed time: %f min.\n", (end-start)/60.0);
+
+	unsigned long int hits, misses;
+	boardEquityStats(&hits, &misses);
+	printf("Equities evaluated: %lu, read from the cache: %lu\n", misses, hits);
+}
+
+/**
+ *  @brief Experiment to compare full matches with matches stopped as soon as
+ *  the winner is known.
+ */
+void ExperimentSequentialMatch (const Player& p1, const Player& p2) {
+	SequentialTest test = SequentialTest::winner();
+
+	for (int i=0; i<10; i++){
+		Player* full1 = p1.clonePlayer();
+		Player* full2 = p2.clonePlayer();
+		PokerGame full(*full1,*full2);
+		full.randomEffectiveStack(true);
+		int n = full.playSeveralHands(100000);
+
+		Player* seq1 = p1.clonePlayer();
+		Player* seq2 = p2.clonePlayer();
+		PokerGame seq(*seq1,*seq2);
+		seq.randomEffectiveStack(true);
+		int m = seq.playSeveralHands(100000,&test);
+
+		printf("Match %d: full %d hands, %.2f +/- %.2f bb/hands; sequential %d hands, %.2f +/- %.2f bb/hands\n",
+				i, n, full1->ev()*100, full1->evHalfWidth()*100,
+				m, seq1->ev()*100, seq1->evHalfWidth()*100);
+
+		delete full1;
+		delete full2;
+		delete seq1;
+		delete seq2;
+	}
+}
+
+/**
+ *  @brief Experiment to check that dealing pairs and suited aces more often
+ *  does not change the estimated performance of a player.
+ */
+void ExperimentImportanceSampling (const Player& p1, const Player& p2, double factor) {
+	DealProposal proposal = DealProposal::rareClasses(factor);
+
+	for (int k=0; k<2; k++){
+		Player* player1 = p1.clonePlayer();
+		Player* player2 = p2.clonePlayer();
+		PokerGame game(*player1,*player2);
+		game.randomEffectiveStack(true);
+		game.startingStack(1000000);
+		if (k) game.importanceSampling(&proposal);
+		game.playSeveralHands(100000);
+
+		printf("%s deals: %.2f +/- %.2f bb/hands\n", (k) ? "Proposed" : "Uniform",
+				player1->ev()*100, player1->evHalfWidth()*100);
+
+		delete player1;
+		delete player2;
+	}
+}
+
+/**
+ *  @brief Experiment to find the best of a random population of RCT players
+ *  racing them instead of playing every match in full.
+ */
+void ExperimentRacing (int n) {
+	std::vector<Player*> players;
+	std::vector<float> raise, call;
+	for (int i=0; i<n; i++){
+		raise.push_back(GARandomFloat(0,1));
+		call.push_back(GARandomFloat(0,1));
+		players.push_back(new RCTPlayer(raise[i],call[i]));
+		players[i]->prepareForCompetition();
+	}
+
+	RacingTournament racing(3);
+	racing.playTournament(players);
+
+	for (int i=0; i<n; i++){
+		printf("RCT(%.2f,%.2f): %lu hands, %.2f +/- %.2f bb/hands\n",
+				raise[i], call[i], players[i]->hands_played(),
+				players[i]->ev()*100, players[i]->evHalfWidth()*100);
+		delete players[i];
+	}
+
+	printf("Racing: %lu hands in %d stages. Full round robin: %lu hands\n",
+			racing.hands(), racing.stages(),
+			(unsigned long int) n*(n-1)*MAX_HANDS_PLAYED);
+}
+
+/**
+ *  @brief Experiment to find the hands where a player loses most chips, by
+ *  role and effective stack.
+ */
+void ExperimentBreakdown (const Player& p1, const Player& p2) {
+	const char* ranks = "AKQJT98765432";
+	const char* buckets[BREAKDOWN_NSTACKS] = {"3-5", "6-9", "10-14", "15-20", "21+"};
+
+	Player* player1 = p1.clonePlayer();
+	Player* player2 = p2.clonePlayer();
+	player1->recordBreakdown(true);
+	PokerGame game(*player1,*player2);
+	game.randomEffectiveStack(true);
+	game.startingStack(1000000);
+	game.playSeveralHands(1000000);
+
+	const EvBreakdown& b = player1->breakdown();
+	printf("Total: %.2f bb/hands\n", player1->ev()*100);
+	for (int r=0; r<BREAKDOWN_NROLES; r++)
+		for (int k=0; k<BREAKDOWN_NSTACKS; k++){
+			// The five hands losing most.
+			std::vector<std::pair<double,int> > cells;
+			for (int h=0; h<NHANDS; h++)
+				cells.push_back(std::make_pair(b.contribution(r,k,h),h));
+			std::sort(cells.begin(),cells.end());
+
+			printf("%s, %s chips:", (r == PlayerRole::SB) ? "SB" : "BB", buckets[k]);
+			for (int i=0; i<5; i++){
+				int h = cells[i].second;
+				int x = h/NRANKS, y = h%NRANKS;
+				printf(" %c%c%s %.2f (%.0f%%)", ranks[std::min(x,y)], ranks[std::max(x,y)],
+						(x < y) ? "s" : (x > y) ? "o" : "", cells[i].first*100,
+						b.frequency(r,k,h)*100);
+			}
+			printf("\n");
+		}
+
+	delete player1;
+	delete player2;
+}
+
 void readfile (const char* filename, const Player& base){
 	std::ifstream in(filename,ios::binary);
 	ResultsReader reader(in,base);
@@ -0,0 +1,150 @@
+#include "external.h"
+#include "io.h"
+
+#include <cstring>
+#include <typeinfo>
+#include <algorithm>
+
+#include <csignal>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+ExternalBot::ExternalBot (const char* command, int timeout) :
+	_command(command),
+	_pid(-1),
+	_to(-1),
+	_from(-1),
+	_timeout(timeout),
+	_valid(false),
+	_busy(false),
+	_decisions(0),
+	_batches(0)
+{
+	_valid = start();
+}
+
+ExternalBot::~ExternalBot (){
+	if (_to >= 0) close(_to);
+	if (_from >= 0) close(_from);
+	if (_pid > 0){
+		if (!_valid) kill(_pid, SIGKILL);
+		waitpid(_pid, NULL, 0);
+	}
+}
+
+bool
+ExternalBot::start (){
+	// Close on exec, so that bots started later do not keep these pipes open.
+	int to[2], from[2];
+	if (pipe2(to, O_CLOEXEC)) return false;
+	if (pipe2(from, O_CLOEXEC)){
+		close(to[0]);
+		close(to[1]);
+		return false;
+	}
+
+	_pid = fork();
+	if (_pid == 0){
+		dup2(to[0], STDIN_FILENO);
+		dup2(from[1], STDOUT_FILENO);
+		execl("/bin/sh", "sh", "-c", _command.c_str(), (char*) NULL);
+		_exit(127);
+	}
+
+	close(to[0]);
+	close(from[1]);
+	_to = to[1];
+	_from = from[0];
+	if (_pid < 0) return false;
+
+	ProtocolHello hello = {PROTOCOL_MAGIC, PROTOCOL_VERSION}, answer;
+	return writeAll(_to, (const char*) &hello, sizeof(hello))
+		&& readAll(_from, (char*) &answer, sizeof(answer), _timeout)
+		&& answer.magic == PROTOCOL_MAGIC && answer.version == PROTOCOL_VERSION;
+}
+
+Action*
+ExternalBot::decide (const GameView& view, const Card* hand){
+	Pending p;
+	p.request.view = wireView(view);
+	p.request.hand[0] = hand[0].id();
+	p.request.hand[1] = hand[1].id();
+	p.response.id = 0;
+	p.response.action = ActionType::FOLD;
+	p.response.to = 0;
+	p.ready = false;
+
+	std::unique_lock<std::mutex> lock(_lock);
+	_pending.push_back(&p);
+	while (!p.ready){
+		if (_busy){
+			_done.wait(lock);
+			continue;
+		}
+
+		// Lead the next round trip, taking every request waiting so far.
+		size_t n = std::min(_pending.size(), (size_t) PROTOCOL_MAX_BATCH);
+		std::vector<Pending*> batch(_pending.begin(), _pending.begin() + n);
+		_pending.erase(_pending.begin(), _pending.begin() + n);
+		_busy = true;
+
+		lock.unlock();
+		bool ok = _valid && roundTrip(batch);
+		lock.lock();
+
+		if (ok) _batches++;
+		else _valid = false;
+		_decisions += n;
+		for (size_t i=0; i<n; i++){
+			if (!ok) batch[i]->response.action = ActionType::FOLD;
+			batch[i]->ready = true;
+		}
+
+		_busy = false;
+		_done.notify_all();
+	}
+	lock.unlock();
+
+	return new Action(ActionType(p.response.action), p.response.to);
+}
+
+bool
+ExternalBot::roundTrip (std::vector<Pending*>& batch){
+	unsigned int n = batch.size();
+
+	BatchHeader header = {n};
+	_request.resize(sizeof(BatchHeader) + n*sizeof(DecisionRequest));
+	memcpy(&_request[0], &header, sizeof(BatchHeader));
+	for (unsigned int i=0; i<n; i++){
+		batch[i]->request.id = i;
+		memcpy(&_request[sizeof(BatchHeader) + i*sizeof(DecisionRequest)],
+				&batch[i]->request, sizeof(DecisionRequest));
+	}
+	if (!writeAll(_to, &_request[0], _request.size())) return false;
+
+	BatchHeader answer;
+	if (!readAll(_from, (char*) &answer, sizeof(BatchHeader), _timeout) || answer.count != n)
+		return false;
+
+	_response.resize(n*sizeof(DecisionResponse));
+	if (!readAll(_from, &_response[0], _response.size(), _timeout)) return false;
+
+	for (unsigned int i=0; i<n; i++){
+		DecisionResponse r;
+		memcpy(&r, &_response[i*sizeof(DecisionResponse)], sizeof(DecisionResponse));
+		if (r.id >= n) return false;
+		if (r.action > ActionType::RAISE) r.action = ActionType::FOLD;
+		batch[r.id]->response = r;
+	}
+
+	return true;
+}
+
+bool
+ExternalPlayer::equal (const Player& other){
+	if (this == &other) return true;
+
+	return typeid(other) == typeid(ExternalPlayer) && other.hash() == hash();
+}
@@ -0,0 +1,175 @@
+#ifndef _EXTERNAL_H_
+#define _EXTERNAL_H_
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#include <sys/types.h>
+
+#include "player.h"
+#include "protocol.h"
+
+/**
+ *  @brief Default milliseconds a bot has to answer a batch.
+ */
+#define EXTERNAL_TIMEOUT 10000
+
+/**
+ *  @brief A bot running in another process, spoken to through pipes with the
+ *  protocol of protocol.h.
+ *
+ *  Any number of threads may ask for decisions at the same time. Requests
+ *  that arrive while a batch is in flight wait for it to finish. The first
+ *  of them then sends all the waiting requests in one batch and hands every
+ *  answer back, so concurrent matches share each round trip.
+ *
+ *  If the bot cannot be started, fails or takes longer than its timeout to
+ *  answer, it is marked as not valid and every decision from then on is a
+ *  fold.
+ */
+class ExternalBot {
+public:
+	/**
+	 *  @brief Starts the bot and greets it.
+	 *
+	 *  @param command Command line of the bot, run by /bin/sh.
+	 *  @param timeout Milliseconds the bot has to answer the greeting and
+	 *  each batch. A negative number waits forever.
+	 *
+	 *  A bot that exits shows up as a failed write, see writeAll().
+	 */
+	ExternalBot (const char* command, int timeout=EXTERNAL_TIMEOUT);
+
+	/**
+	 *  @brief Closes the pipes, which tells the bot to finish, and waits for
+	 *  it. A bot that is not valid may hang, so it is killed first.
+	 */
+	~ExternalBot ();
+
+	/**
+	 *  @brief Returns false if the bot could not be started or failed.
+	 */
+	bool
+	valid () const { return _valid; }
+
+	/**
+	 *  @brief Returns the command line of the bot.
+	 */
+	const std::string&
+	command () const { return _command; }
+
+	/**
+	 *  @brief Asks the bot for a decision. It blocks until the answer
+	 *  arrives or the bot times out.
+	 *
+	 *  @param view State of the hand as seen by the bot.
+	 *  @param hand Hole cards of the bot.
+	 *
+	 *  The caller must take the responsibility of destroying the action.
+	 */
+	Action*
+	decide (const GameView& view, const Card* hand);
+
+	/**
+	 *  @brief Returns the number of decisions taken so far.
+	 */
+	unsigned long int
+	decisions () const { return _decisions; }
+
+	/**
+	 *  @brief Returns the number of round trips made so far.
+	 */
+	unsigned long int
+	batches () const { return _batches; }
+
+private:
+	ExternalBot (const ExternalBot&);
+	ExternalBot& operator= (const ExternalBot&);
+
+	struct Pending {
+		DecisionRequest request;
+		DecisionResponse response;
+		bool ready;
+	};
+
+	bool
+	start ();
+
+	bool
+	roundTrip (std::vector<Pending*>& batch);
+
+	std::string _command;
+	pid_t _pid;
+	int _to, _from;
+	int _timeout;
+	bool _valid;
+
+	std::mutex _lock;
+	std::condition_variable _done;
+	std::vector<Pending*> _pending;
+	bool _busy;
+
+	unsigned long int _decisions, _batches;
+
+	/**
+	 *  Buffers of the batch in flight.
+	 */
+	std::vector<char> _request, _response;
+};
+
+/**
+ *  @brief A player whose decisions are taken by an ExternalBot.
+ *
+ *  The bot is not owned by the player and must outlive it and its clones.
+ *  Clones share the bot, so a tournament that clones the player for each
+ *  match, such as OneVsAllTournament, batches the decisions of all its
+ *  matches.
+ */
+class ExternalPlayer : public Player {
+public:
+	/**
+	 *  @brief Constructs the player.
+	 *
+	 *  @param bot The bot that takes the decisions.
+	 */
+	ExternalPlayer (ExternalBot& bot) :
+		Player (),
+		_bot(&bot) {}
+
+	/**
+	 *  @brief Clones the player. The clone uses the same bot.
+	 */
+	Player*
+	clonePlayer () const {
+		return new ExternalPlayer(*this);
+	}
+
+	/**
+	 *  @brief Comparator. Players are equal if they run the same command.
+	 */
+	bool
+	equal (const Player& other);
+
+	/**
+	 *  Inherited from Player. Hashes the type and the command of the bot.
+	 */
+	unsigned long long
+	hash () const {
+		return hashBytes(_bot->command().data(), _bot->command().size(), Player::hash()); }
+
+protected:
+	/**
+	 *  @brief Asks the bot.
+	 *
+	 *  @param view Game state.
+	 */
+	Action*
+	caction (const GameView& view) { return _bot->decide(view, _hand); }
+
+private:
+	ExternalBot* _bot;
+};
+
+#endif
@@ -1,8 +1,16 @@
 #include "game.h"
+#include "pushfold.h"
 #include <iostream>
+#include <climits>
 
 using namespace std;
 
+/**
+ *  @brief Returns the number of seats in a set.
+ */
+static inline int
+count (unsigned int mask) { return __builtin_popcount(mask); }
+
 char*
 str_cards(Card* cards, int n){
 	char* str = new char[n*2+1];
@@ -14,240 +22,513 @@ str_cards(Card* cards, int n){
 }
 
 PokerGame::PokerGame(Player& player1, Player& player2){
-	_players.push_back(&player1);
-	_players.push_back(&player2);
-	_dealer = _players.begin();
-	_pot = 0;
-	_roundBet = 0;
-	_effectiveStack = 20;
-	_randomEffectiveStack = false;
-	_dealer_pos = 0;
+	Player* players[2] = {&player1, &player2};
+	sit(players, 2);
+}
+
+PokerGame::PokerGame(Player** players, int n){
+	sit(players, n);
 }
 
 PokerGame::~PokerGame(){
 }
 
 void
-PokerGame::playSeveralHands (int n){
+PokerGame::sit (Player** players, int n){
+	_nseats = min(n, MAX_SEATS);
+	for (int i=0; i<_nseats; i++)
+		_seats[i] = players[i];
+
+	_alive = (1u << _nseats) - 1;
+	_playing = _allin = _ready = 0;
+	_dealer_pos = 0;
+	_pot = 0;
+	_roundBet = 0;
+	_startingStack = 1000;
+	_effectiveStack = 20;
+	_dealtStack = 20;
+	_proposal = NULL;
+	_stackWeight = _dealWeight = 1;
+	_randomEffectiveStack = false;
+	_allInAdjusted = false;
+	_lockedCards = -1;
+	_replay = 0;
+	_recording = false;
+
+	const CompiledStrategy* s1 = compiledStrategy(*_seats[0]);
+	const CompiledStrategy* s2 = (_nseats == 2) ? compiledStrategy(*_seats[1]) : NULL;
+	if (s1 && s2){
+		_values[0] = std::make_shared<DealValue>(*s1, *s2);
+		_values[1] = std::make_shared<DealValue>(*s2, *s1);
+	}
+}
+
+int
+PokerGame::playSeveralHands (int n, const SequentialTest* test){
 	std::default_random_engine generator;
-	std::uniform_int_distribution<int> uniform(3,20);
+	std::uniform_int_distribution<int> uniform(DEAL_MIN_STACK,DEAL_MAX_STACK);
 
-	for (player_t it = _players.begin(); it != _players.end(); it++){
-		(*it)->stack(1000);
+	_alive = (1u << _nseats) - 1;
+	for (int s=0; s<_nseats; s++){
+		_seats[s]->stack(_startingStack);
 	}
 
-	int num_players = _players.size();
+	RunningStats start = _seats[0]->results();
 	int i = 0;
 
-	while (num_players > 1 && i++ < n){
-		if (_randomEffectiveStack) _effectiveStack = uniform(generator);
-		else _effectiveStack = 20;
-
-		//Reset players
-		for (player_t it = _players.begin(); it != _players.end(); it++){
-			(*it)->bet(0);
-			_effectiveStack = min(_effectiveStack,(*it)->stack());
-		}
+	while (count(_alive) > 1 && i < n){
+		i++;
+		if (!_randomEffectiveStack) _effectiveStack = 20;
+		else if (_proposal) _stackWeight = _proposal->drawStack(&_effectiveStack);
+		else _effectiveStack = uniform(generator);
 
 		playHand();
 
-		for (player_t it = _players.begin(); it != _players.end(); it++){
-			if ((*it)->stack() < 3){
-				removePlayer(it);
-				num_players--;
-			}
+		for (int s=0; s<_nseats; s++){
+			if ((_alive & (1u << s)) && _seats[s]->stack() < 3)
+				_alive &= ~(1u << s);
 		}
 
-		/**
-		 * Important: for more than 2 players this may not work when one of the
-		 * players was removed.
-		 */
-		_dealer_pos = (_dealer_pos + 1) % _players.size();
+		_dealer_pos = nextSeat(_dealer_pos, _alive);
+
+		if (test && test->resolved(_seats[0]->results().since(start)))
+			break;
 	}
+
+	return i;
 }
 
 void
-PokerGame::playHand () {
-	//Create a new round of players.
-	_playing = list<Player*>(_players.begin(),_players.end());
-	_ready.clear();
-	_pot = 0;
-	_roundBet = 0;
+PokerGame::replayHands (const vector<HandRecord>& records){
+	for (vector<HandRecord>::const_iterator r = records.begin(); r != records.end(); r++){
+		if (r->nseats != _nseats) continue;
+
+		// Every deal is played with the stacks it was recorded with, whatever
+		// the players won or lost in the previous ones.
+		_alive = (1u << _nseats) - 1;
+		for (int s=0; s<_nseats; s++)
+			_seats[s]->stack(max<int>(_startingStack, r->effectiveStack));
 
-	//Establish the first player.
-	_current = _playing.begin();
-	advance(_current, _dealer_pos);
-	_first = _current;
+		replayHand(*r);
+	}
+}
+
+void
+PokerGame::playHand () {
+	_replay = 0;
 
 	//Shuffle the deck.
 	_deck.shuffle();
 
-	//Establish each players' role
-	//Button
-	_button = _current;
+	play();
+}
+
+void
+PokerGame::replayHand (const HandRecord& record) {
+	_replay = &record;
+	_dealer_pos = record.dealer;
+	_effectiveStack = record.effectiveStack;
+
+	play();
+
+	_replay = 0;
+}
+
+void
+PokerGame::play () {
+	//Create a new round of players.
+	_playing = _alive;
+	_allin = 0;
+	_pot = 0;
+	_lockedCards = -1;
+	_view.clear();
+
+	for (int s=0; s<_nseats; s++){
+		_committed[s] = 0;
+		_seats[s]->bet(0);
+		_handStack[s] = min<int>(_effectiveStack, _seats[s]->stack());
+	}
+
+	//Establish each players' role. Heads-up the button posts the small blind.
+	if (count(_playing) == 2)
+		_sb = _dealer_pos;
+	else {
+		_seats[_dealer_pos]->setRole(PlayerRole::BTN);
+		_sb = nextSeat(_dealer_pos, _playing);
+	}
+	_bb = nextSeat(_sb, _playing);
+	for (int s = nextSeat(_bb, _playing); s != _dealer_pos; s = nextSeat(s, _playing))
+		_seats[s]->setRole(PlayerRole::UTG);
 
 	//Small blind
-	_sb = nextPlayer(_current);
-	(*_current)->setRole(PlayerRole::SB);
-	(*_current)->bet((*_current)->bet() + 1);
-	_pot += 1;
+	_seats[_sb]->setRole(PlayerRole::SB);
+	commit(_sb, 1);
 
 	//Big blind
-	nextPlayer(_current);
-	(*_current)->setRole(PlayerRole::BB);
-	(*_current)->bet((*_current)->bet() + 2);
-	_pot += 2;
+	_seats[_bb]->setRole(PlayerRole::BB);
+	commit(_bb, 2);
+
+	_roundBet = max(_committed[_sb], _committed[_bb]);
 
-	_roundBet = 3; //blinds
-	
 	// Give the initial cards
-	_current = _sb;
-	do {
-		(*_current)->firstCard(_deck.popCard());
-		(*_current)->secondCard(_deck.popCard());
+	if (_replay){
+		for (int s=0; s<_nseats; s++){
+			_seats[s]->firstCard(_replay->hole[s][0]);
+			_seats[s]->secondCard(_replay->hole[s][1]);
+		}
+	}
+	else {
+		_dealWeight = 1;
+		bool proposed = _proposal && (_playing & 1);
+		if (proposed){
+			Card hand[2];
+			_dealWeight = _proposal->drawHand(hand);
+			_deck.remove(hand[0].id());
+			_deck.remove(hand[1].id());
+			_seats[0]->firstCard(hand[0]);
+			_seats[0]->secondCard(hand[1]);
+		}
+
+		int s = _sb;
+		do {
+			if (s == 0 && proposed) continue;
+			_seats[s]->firstCard(_deck.popCard());
+			_seats[s]->secondCard(_deck.popCard());
+		}
+		while ((s = nextSeat(s, _playing)) != _sb);
 	}
-	while (nextPlayer(_current) != _sb);
+	if (_replay) _dealWeight = 1;
+	_dealWeight *= _stackWeight;
+	_stackWeight = 1;
+
+	_dealtStack = effectiveStack(_sb);
+
+	_recording = !_observers.empty() && _nseats <= HISTORY_SEATS;
+	if (_recording) recordDeal();
 
 	// Preflop betting rounds --
-	betting_round();
+	betting_round(nextSeat(_bb, _playing));
+	lockAllIn(0);
 
 	// Flop
-	_dead_cards[0] = _deck.popCard(); // Burn a card
-	_community_cards[0] = _deck.popCard();
-	_community_cards[1] = _deck.popCard();
-	_community_cards[2] = _deck.popCard();
-	if (_roundBet < _effectiveStack)
-		betting_round();
+	if (_replay){
+		// Burnt cards are not recorded. They are not needed to evaluate
+		// a complete board.
+		for (int i=0; i<5; i++)
+			_community_cards[i] = _replay->board[i];
+	}
+	else {
+		_dead_cards[0] = _deck.popCard(); // Burn a card
+		_community_cards[0] = _deck.popCard();
+		_community_cards[1] = _deck.popCard();
+		_community_cards[2] = _deck.popCard();
+	}
+	_view.street = Street::FLOP;
+	_view.addCard(_community_cards[0].id());
+	_view.addCard(_community_cards[1].id());
+	_view.addCard(_community_cards[2].id());
+	betting_round(nextSeat(_dealer_pos, _playing));
+	lockAllIn(3);
 
 	// Turn
-	_dead_cards[1] = _deck.popCard(); // Burn a card
-	_community_cards[3] = _deck.popCard();
-	if (_roundBet < _effectiveStack)
-		betting_round();
+	if (!_replay){
+		_dead_cards[1] = _deck.popCard(); // Burn a card
+		_community_cards[3] = _deck.popCard();
+	}
+	_view.street = Street::TURN;
+	_view.addCard(_community_cards[3].id());
+	betting_round(nextSeat(_dealer_pos, _playing));
+	lockAllIn(4);
 
 	// River
-	_dead_cards[2] = _deck.popCard(); // Burn a card
-	_community_cards[4] = _deck.popCard();
-	if (_roundBet < _effectiveStack)
-		betting_round();
+	if (!_replay){
+		_dead_cards[2] = _deck.popCard(); // Burn a card
+		_community_cards[4] = _deck.popCard();
+	}
+	_view.street = Street::RIVER;
+	_view.addCard(_community_cards[4].id());
+	betting_round(nextSeat(_dealer_pos, _playing));
 
 	// Showdown
-	double* shares;
-	if (_playing.size() > 1)
-		shares = showdown();
-	else {
-		shares = new double[1];
-		*shares = 1;
-	}
+	prizes();
 
-	prizes(shares);
+	if (count(_alive) == 2) notifyHandFinished(_dealtStack);
+
+	if (_recording) recordResults();
 }
 
 void
-PokerGame::betting_round () {
-	int num_players = _playing.size();
-	while (num_players > 1 && _ready.size() != num_players){
-		Action* a = (*_current)->action(this);
+PokerGame::betting_round (int first) {
+	_ready = 0;
+
+	int current = first;
+	while (count(_playing) > 1){
+		unsigned int active = _playing & ~_allin;
+		unsigned int pending = active & ~_ready;
+		if (pending == 0) break;
+
+		// Nobody left to bet against.
+		if (count(active) == 1 && _committed[__builtin_ctz(active)] >= _roundBet)
+			break;
+
+		if (!(pending & (1u << current)))
+			current = nextSeat(current, pending);
+
+		_view.role = _seats[current]->role();
+		_view.pot = _pot;
+		_view.roundBet = _roundBet;
+		_view.effectiveStack = effectiveStack(current);
+		_view.nplaying = count(_playing);
+		Action* a = _seats[current]->action(_view);
+		_view.push(a->type());
+
+		unsigned int bit = 1u << current;
 		if (a->type() == ActionType::FOLD){
-			num_players--;
-			// pot stays the same
-			(*_current)->update_ev(-(*_current)->bet());
-			removePlayer(_current); //_playing and _current
-			// _ready remains the same
-			
+			// Chips committed stay in the pot
+			_playing &= ~bit;
+
 		} else if (a->type() == ActionType::CALL) {
-			int increase = a->to() - (*_current)->bet();
-			_pot += increase; //_pot
-			//_playing remains the same
-			_ready.insert(*_current); // _ready
-			(*_current)->bet((*_current)->bet() + increase);
-			nextPlayer(_current); //_current
+			commit(current, _roundBet);
+			_ready |= bit;
 
 		} else if (a->type() == ActionType::RAISE){
-			int increase = a->to() - (*_current)->bet();
-			_pot += increase; // _pot
-			_roundBet = a->to();
-			//_playing remains the same
-			_ready.clear(); // _ready
-			_ready.insert(*_current);
-			(*_current)->bet((*_current)->bet() + increase);
-			nextPlayer(_current); //_current
+			commit(current, max(a->to(), _roundBet));
+			// An all-in for less than the bet does not reopen the betting.
+			if (_committed[current] > _roundBet){
+				_roundBet = _committed[current];
+				_ready = 0;
+			}
+			_ready |= bit;
 		}
 
 		delete a;
 	}
 }
 
-double*
-PokerGame::showdown (){
-	player_t tmp = _first;
-	char* hands = new char[_playing.size()*5], *ptr = hands;
-	char* str_com = str_cards(_community_cards, 5);
-	char* str_dead = str_cards(_dead_cards,3);
-	Results* res = alloc_results();
+void
+PokerGame::commit (int seat, int to){
+	to = min(to, _handStack[seat]);
+	if (to > _committed[seat]){
+		_pot += to - _committed[seat];
+		_committed[seat] = to;
+		_seats[seat]->bet(to);
+	}
+	if (_committed[seat] == _handStack[seat])
+		_allin |= 1u << seat;
+}
 
-	char* tmp_hand = str_cards((*tmp)->hand(),2);
-	strncpy(ptr,tmp_hand,4);
-	delete [] tmp_hand;
-	ptr += 4;
-	nextPlayer(tmp);
+int
+PokerGame::nextSeat (int seat, unsigned int mask) const {
+	unsigned int after = mask & ~((2u << seat) - 1);
+	if (after) return __builtin_ctz(after);
+	return (mask) ? __builtin_ctz(mask) : seat;
+}
 
-	do {
-		strncpy(ptr++,":",1);
-		tmp_hand = str_cards((*tmp)->hand(),2);
+int
+PokerGame::effectiveStack (int seat) const {
+	int most = 0;
+	for (unsigned int m = _playing & ~(1u << seat); m; m &= m - 1)
+		most = max(most, _handStack[__builtin_ctz(m)]);
+	return min(_handStack[seat], most);
+}
+
+void
+PokerGame::lockAllIn (int cards){
+	if (_lockedCards < 0 && count(_playing) > 1 && count(_playing & ~_allin) <= 1)
+		_lockedCards = cards;
+}
+
+void
+PokerGame::showdown (unsigned int mask, unsigned short* shares, int cards){
+	char hands[5*MAX_SEATS], *ptr = hands;
+	char* str_com = str_cards(_community_cards, cards);
+	// Cards burnt before the board is complete were not seen by anyone.
+	char* str_dead = str_cards(_dead_cards,(_replay || cards < 5) ? 0 : 3);
+	Results* res = alloc_results();
+
+	for (unsigned int m = mask; m; m &= m - 1){
+		if (ptr != hands) *ptr++ = ':';
+		char* tmp_hand = str_cards(_seats[__builtin_ctz(m)]->hand(),2);
 		strncpy(ptr,tmp_hand,4);
 		delete [] tmp_hand;
 		ptr += 4;
 	}
-	while (nextPlayer(tmp) != _first);
 	*ptr = '\0';
 
 	calc(hands, str_com, str_dead, MC_ITER, res);
 
-	double* shares = new double[res->size];
-	memcpy(shares,res->ev,res->size*sizeof(double));
+	double* rptr = res->ev;
+	for (unsigned int m = mask; m; m &= m - 1)
+		shares[__builtin_ctz(m)] = (unsigned short) lround(*rptr++ * SHARE_SCALE);
 
 	free_results(res);
-	delete [] hands;
 	delete [] str_com;
 	delete [] str_dead;
+}
+
+bool
+PokerGame::storedShowdown (unsigned int mask, unsigned short* shares){
+	if (mask != _replay->showdown) return false;
 
-	return shares;
+	for (unsigned int m = mask; m; m &= m - 1)
+		shares[__builtin_ctz(m)] = _replay->share[__builtin_ctz(m)];
+
+	return true;
 }
 
 void
-PokerGame::prizes (double* shares){
-	player_t tmp = _first;
+PokerGame::prizes (){
+	int won[MAX_SEATS];
+	double expected[MAX_SEATS];
+	bool adjusted = _allInAdjusted && _lockedCards >= 0;
+	for (int s=0; s<_nseats; s++){
+		won[s] = 0;
+		expected[s] = 0;
+	}
+
+	if (count(_playing) == 1)
+		won[__builtin_ctz(_playing)] = _pot;
+	else {
+		// Every different amount put in by the players still in the hand
+		// closes a pot contested by those who put in at least that much.
+		// The first one is the main pot, contested by all of them.
+		unsigned int left = _playing;
+		int prev = 0, given = 0;
+		while (left){
+			int level = INT_MAX;
+			for (unsigned int m = left; m; m &= m - 1)
+				level = min(level, _committed[__builtin_ctz(m)]);
+
+			unsigned int closed = 0;
+			for (unsigned int m = left; m; m &= m - 1)
+				if (_committed[__builtin_ctz(m)] == level) closed |= m & -m;
+
+			int amount = 0;
+			if (closed == left)
+				amount = _pot - given; // Last pot takes any uncalled chips.
+			else
+				for (int s=0; s<_nseats; s++)
+					amount += min(_committed[s], level) - min(_committed[s], prev);
+
+			unsigned short shares[MAX_SEATS];
+			if (count(left) == 1)
+				shares[__builtin_ctz(left)] = SHARE_SCALE;
+			else {
+				if (!_replay || !storedShowdown(left, shares))
+					showdown(left, shares);
+				if (_recording && left == _playing)
+					recordShowdown(shares);
+			}
+
+			int split = 0;
+			for (unsigned int m = left; m; m &= m - 1){
+				int s = __builtin_ctz(m);
+				int w = amount*shares[s]/SHARE_SCALE;
+				won[s] += w;
+				split += w;
+			}
+			// Odd chips go to the first player after the button among
+			// those with the largest share.
+			int best = 0;
+			for (unsigned int m = left; m; m &= m - 1)
+				best = max<int>(best, shares[__builtin_ctz(m)]);
+			int odd = nextSeat(_dealer_pos, left);
+			while (shares[odd] != best)
+				odd = nextSeat(odd, left);
+			won[odd] += amount - split;
+
+			// The same pot, shared by the equities when the players went all-in.
+			if (adjusted){
+				if (count(left) > 1)
+					showdown(left, shares, _lockedCards);
+				for (unsigned int m = left; m; m &= m - 1)
+					expected[__builtin_ctz(m)] += amount*shares[__builtin_ctz(m)]/(double) SHARE_SCALE;
+			}
 
-	double* rptr = shares;
-	do {
-		(*tmp)->update_ev(_pot*(*rptr) - (*tmp)->bet());
-		rptr++;
-	} while (nextPlayer(tmp) != _first);
+			given += amount;
+			prev = level;
+			left &= ~closed;
+		}
+	}
 
-	delete [] shares;
+	for (int s=0; s<_nseats; s++){
+		if (!(_alive & (1u << s))) continue;
+
+		int quantity = won[s] - _committed[s];
+		double credited = (adjusted) ? expected[s] - _committed[s] : quantity;
+		int hand = handToNumeric(_seats[s]->firstCard(), _seats[s]->secondCard());
+		int role = _seats[s]->role();
+		// Deal values are only built heads-up, for seats 0 and 1.
+		if (_nseats == 2 && _values[_sb])
+			_seats[s]->update_ev(quantity, _dealWeight*credited, role, hand, _dealtStack,
+					_dealWeight*_values[_sb]->luck(role, hand, _dealtStack), STRATEGY_LUCK);
+		else
+			_seats[s]->update_ev(quantity, _dealWeight*credited, role, hand, _dealtStack,
+					_dealWeight*dealLuck(hand, _dealtStack));
+	}
+}
+
+void
+PokerGame::notifyHandFinished (int stack){
+	int first = __builtin_ctz(_alive);
+	int second = nextSeat(first, _alive);
+	bool shown = count(_playing) == 2;
+
+	GameView end = _view;
+	end.effectiveStack = stack;
+	end.nplaying = count(_playing);
+
+	end.role = _seats[first]->role();
+	_seats[first]->handFinished(end, (shown) ? _seats[second]->hand() : NULL);
+
+	end.role = _seats[second]->role();
+	_seats[second]->handFinished(end, (shown) ? _seats[first]->hand() : NULL);
 }
 
 void
 PokerGame::output_results (){
 	FILE* out = fopen("data.csv","a");
 	if (out != NULL){
-		fprintf(out,"%f\n",_players.front()->ev());
+		fprintf(out,"%f\n",_seats[0]->ev());
 		fclose(out);
 	}
 }
 
-list<Player*>::iterator&
-PokerGame::nextPlayer (list<Player*>::iterator& p){
-	if (++p == _playing.end())
-		p = _playing.begin();
-	return p;
+void
+PokerGame::recordDeal (){
+	_record.nseats = _nseats;
+	_record.dealer = _dealer_pos;
+	_record.effectiveStack = effectiveStack(_sb);
+	_record.showdown = 0;
+
+	for (int s=0; s<_nseats; s++){
+		_record.hole[s][0] = _seats[s]->firstCard().id();
+		_record.hole[s][1] = _seats[s]->secondCard().id();
+		_record.share[s] = 0;
+		_stacks[s] = _seats[s]->stack();
+	}
 }
 
-list<Player*>::iterator&
-PokerGame::removePlayer (list<Player*>::iterator& p){
-	if (_first == p) nextPlayer(_first);
-	p = _playing.erase(p);
-	if (p == _playing.end()) p = _playing.begin();
-	return p;
+void
+PokerGame::recordShowdown (unsigned short* shares){
+	for (unsigned int m = _playing; m; m &= m - 1){
+		int s = __builtin_ctz(m);
+		_record.showdown |= 1 << s;
+		_record.share[s] = shares[s];
+	}
+}
+
+void
+PokerGame::recordResults (){
+	for (int i=0; i<5; i++)
+		_record.board[i] = _community_cards[i].id();
+
+	for (int s=0; s<_nseats; s++)
+		_record.result[s] = (int) _seats[s]->stack() - _stacks[s];
+
+	_record.history = _view.history;
+	_record.nactions = _view.nactions;
+
+	for (vector<GameObserver*>::iterator it = _observers.begin(); it != _observers.end(); it++)
+		(*it)->handPlayed(_record);
 }
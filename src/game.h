@@ -3,19 +3,23 @@
 
 #include <cstring>
 #include <cstdio>
-#include <list>
-#include <set>
 #include <algorithm>
 #include <random>
 #include <iterator>
+#include <vector>
+#include <memory>
 
 #include <pbots_calc/pbots_calc.h>
 #define MC_ITER 1000
 
 #include "deck.h"
+#include "sampling.h"
 #include "player.h"
 #include "action.h"
 #include "card.h"
+#include "gameview.h"
+#include "history.h"
+#include "equity.h"
 
 using namespace std;
 
@@ -33,6 +37,14 @@ char* str_cards(Card* cards, int n);
 
 /**
  *  @brief Poker game simulator.
+ *
+ *  Seats are kept in fixed-size arrays and sets of seats (still alive, still
+ *  in the hand, all-in...) in bitmasks, so playing a hand allocates nothing
+ *  besides the actions returned by the players. Bets are capped by each
+ *  player's own stack and side pots are settled at showdown. Heads-up, both
+ *  players are told how every hand ended through Player::handFinished, and
+ *  the luck of their deals is their DealValue when both strategies are
+ *  compiled.
  */
 class PokerGame {
 public:
@@ -45,6 +57,19 @@ public:
 	 */
 	PokerGame(Player& player1, Player& player2);
 
+	/**
+	 *  @brief Creates a new game engine with several players.
+	 *
+	 *  @param players Array of players, in seat order.
+	 *  @param n Number of players, between 2 and MAX_SEATS.
+	 *
+	 *  Push/fold players only know the decisions of the blinds heads-up. The
+	 *  first one to act in an unraised pot decides whether to shove like the
+	 *  small blind, and the ones facing a shove whether to call like the big
+	 *  blind, as told by Player::pushFoldRole.
+	 */
+	PokerGame(Player** players, int n);
+
 	/**
 	 *  @brief Destructor
 	 */
@@ -62,9 +87,41 @@ public:
 	 *  @brief Resets the players and simulates a certain number of hands.
 	 *
 	 *  @param n Number of hands to be played.
+	 *  @param test If given, the match stops as soon as the rule is met.
+	 *  @return Number of hands played.
+	 *
+	 *  Players left with less than 3 chips are eliminated and the button
+	 *  moves to the next seat still alive. It stops earlier if only one
+	 *  player is left.
+	 */
+	int
+	playSeveralHands (int n, const SequentialTest* test = NULL);
+
+	/**
+	 *  @brief Plays a single hand dealing the cards, dealer position and
+	 *  effective stack stored in a record instead of shuffling the deck.
+	 *
+	 *  @param record The deal to reproduce. It must have as many seats as
+	 *  the game.
+	 *
+	 *  If the same players that reached the showdown in the record reach it
+	 *  again, the stored showdown shares are used and no hand evaluation is
+	 *  needed.
+	 */
+	void
+	replayHand (const HandRecord& record);
+
+	/**
+	 *  @brief Resets the players and replays a set of recorded deals.
+	 *
+	 *  @param records The deals to be played. Records with a different number
+	 *  of seats are skipped.
+	 *
+	 *  Stacks are reset before each deal, so every player plays every deal
+	 *  with the effective stack of its record.
 	 */
 	void
-	playSeveralHands (int n);
+	replayHands (const vector<HandRecord>& records);
 
 	//const string& state ();
 		
@@ -75,11 +132,24 @@ public:
 	roundBet () const { return _roundBet; }
 
 	/**
-	 *  @brief Returns the current effective stack.
+	 *  @brief Returns the current effective stack. No player can bet more
+	 *  than this amount in a hand.
 	 */
 	int
 	effectiveStack () const {return _effectiveStack; }
 
+	/**
+	 *  @brief Sets the stack every player starts with in playSeveralHands.
+	 */
+	void
+	startingStack (int stack) { _startingStack = stack; }
+
+	/**
+	 *  @brief Returns the number of seats.
+	 */
+	int
+	seats () const { return _nseats; }
+
 	/**
 	 *  @brief Sets whether the effective stack will be chosen randomly
 	 *  or not.
@@ -88,32 +158,136 @@ public:
 	 */
 	void
 	randomEffectiveStack (bool b) { _randomEffectiveStack = b; }
+
+	/**
+	 *  @brief Sets whether players are credited with the expected result of
+	 *  the hands in which every player left is all-in, instead of the chips
+	 *  they won.
+	 *
+	 *  Cards are still dealt and chips still change hands as usual, so
+	 *  stacks, eliminations and Player::realizedEv() follow the real
+	 *  outcomes. Only Player::ev() and Player::results() are adjusted, which
+	 *  removes the luck of the cards dealt after the all-in from them.
+	 */
+	void
+	allInAdjusted (bool b) { _allInAdjusted = b; }
+
+	/**
+	 *  @brief Deals the hand of the first seat, and the effective stack when
+	 *  it is random, from a proposal instead of uniformly. NULL goes back to
+	 *  uniform deals.
+	 *
+	 *  Chips change hands as usual, but players are credited with their
+	 *  results times the likelihood ratio of the deal, so that ev() and
+	 *  results() stay unbiased. The proposal must outlive the game.
+	 */
+	void
+	importanceSampling (const DealProposal* proposal) { _proposal = proposal; }
+
+	/**
+	 *  @brief Returns the state of the hand as seen by the player to act.
+	 */
+	const GameView&
+	view () const { return _view; }
+
+	/**
+	 *  @brief Attaches an observer. The observer will be notified of every
+	 *  hand played.
+	 *
+	 *  @param observer The observer to attach.
+	 *
+	 *  Hand records are only built while there is an observer attached.
+	 */
+	void
+	attachObserver (GameObserver* observer) { _observers.push_back(observer); }
+
+	/**
+	 *  @brief Detaches an observer.
+	 *
+	 *  @param observer The observer to detach.
+	 */
+	void
+	detachObserver (GameObserver* observer) {
+		_observers.erase(std::find(_observers.begin(),_observers.end(),observer)); }
 		
 private:
-	typedef list<Player*>::iterator player_t;
-
-	list<Player*>::iterator& nextPlayer (list<Player*>::iterator& p);
-	list<Player*>::iterator& removePlayer (list<Player*>::iterator& p);
-	void betting_round ();
-	double* showdown ();
-	void prizes (double* shares);
+	void sit (Player** players, int n);
+	int nextSeat (int seat, unsigned int mask) const;
+	int effectiveStack (int seat) const;
+	void commit (int seat, int to);
+	void play ();
+	void betting_round (int first);
+	void showdown (unsigned int mask, unsigned short* shares, int cards = 5);
+	void lockAllIn (int cards);
+	bool storedShowdown (unsigned int mask, unsigned short* shares);
+	void prizes ();
+	void notifyHandFinished (int stack);
 
 	void output_results ();
 
+	void recordDeal ();
+	void recordShowdown (unsigned short* shares);
+	void recordResults ();
+
 	Deck _deck;
 
-	list<Player*> _players,_playing;
-	list<Player*>::iterator _dealer;
-	list<Player*>::iterator _current,_first,_button,_sb;
-	int _dealer_pos;
-		
-	set<Player*> _ready;
+	Player* _seats[MAX_SEATS];
+	int _nseats;
+
+	/**
+	 *  Sets of seats. Bit i stands for seat i.
+	 */
+	unsigned int _alive, _playing, _allin, _ready;
+
+	int _dealer_pos, _sb, _bb;
+
+	/**
+	 *  Chips put in the pot during the current hand and maximum amount each
+	 *  seat can put in it.
+	 */
+	int _committed[MAX_SEATS], _handStack[MAX_SEATS];
 
 	Card _community_cards[5], _dead_cards[3];
 	int _pot,_roundBet;
-	int _minStack, _effectiveStack;
+	int _startingStack, _effectiveStack;
+
+	/**
+	 *  Effective stack of the blinds when the cards of the hand were dealt.
+	 */
+	int _dealtStack;
+
+	const DealProposal* _proposal;
+
+	/**
+	 *  Likelihood ratios of the effective stack drawn for the next hand and
+	 *  of the whole deal of the current one.
+	 */
+	double _stackWeight, _dealWeight;
+
+	/**
+	 *  Values of the deals when each seat is the small blind, set only
+	 *  heads-up between two players with a compiled strategy. Copies of the
+	 *  game share them.
+	 */
+	std::shared_ptr<const DealValue> _values[2];
 
 	bool _randomEffectiveStack;
+	bool _allInAdjusted;
+
+	/**
+	 *  Community cards dealt when every player left went all-in, -1 if they
+	 *  did not.
+	 */
+	int _lockedCards;
+
+	const HandRecord* _replay;
+
+	GameView _view;
+
+	vector<GameObserver*> _observers;
+	bool _recording;
+	HandRecord _record;
+	int _stacks[HISTORY_SEATS];
 };
 
 #endif
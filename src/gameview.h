@@ -0,0 +1,125 @@
+#ifndef _GAMEVIEW_H_
+#define _GAMEVIEW_H_
+
+#include <type_traits>
+
+#include "action.h"
+
+/**
+ *  @brief Maximum number of players sitting at a table.
+ */
+#define MAX_SEATS 9
+
+/**
+ *  @brief Position of a player in the current hand. UTG stands for any seat
+ *  acting before the button preflop.
+ */
+enum PlayerRole {SB,BB,BTN,UTG};
+
+/**
+ *  @brief Number of values of PlayerRole.
+ */
+#define NROLES 4
+
+/**
+ *  @brief Betting rounds of a hand.
+ */
+enum Street {
+	PREFLOP=0,
+	FLOP,
+	TURN,
+	RIVER
+};
+
+/**
+ *  @brief Maximum number of actions kept in the history of a GameView.
+ */
+#define MAX_HISTORY 32
+
+/**
+ *  @brief Compact snapshot of the state of a hand as seen by the player who
+ *  has to act.
+ *
+ *  The engine builds it once per decision and hands it to the player by const
+ *  reference. It is trivially copyable, so it can also be stored, replayed or
+ *  batched without a live PokerGame behind it.
+ */
+struct GameView {
+	/**
+	 *  @brief Community cards. Bit i is set if the card with identifier i
+	 *  is on the board.
+	 */
+	unsigned long long board;
+
+	/**
+	 *  @brief Actions taken so far in the hand, two bits per action with the
+	 *  oldest one in the lowest bits.
+	 */
+	unsigned long long history;
+
+	short effectiveStack;
+	short pot;
+	short roundBet;
+
+	/**
+	 *  @brief PlayerRole of the player to act.
+	 */
+	unsigned char role;
+
+	/**
+	 *  @brief Current Street.
+	 */
+	unsigned char street;
+
+	/**
+	 *  @brief Number of actions stored in %history.
+	 */
+	unsigned char nactions;
+
+	/**
+	 *  @brief Number of players that have not folded yet.
+	 */
+	unsigned char nplaying;
+
+	/**
+	 *  @brief Resets the view to the beginning of a hand.
+	 */
+	void
+	clear () {
+		board = 0;
+		history = 0;
+		effectiveStack = pot = roundBet = 0;
+		role = PlayerRole::SB;
+		street = Street::PREFLOP;
+		nactions = 0;
+		nplaying = 2;
+	}
+
+	/**
+	 *  @brief Appends an action to the history. Actions beyond MAX_HISTORY
+	 *  are not recorded.
+	 */
+	void
+	push (ActionType a) {
+		if (nactions == MAX_HISTORY) return;
+		history |= (unsigned long long) a << (2*nactions);
+		nactions++;
+	}
+
+	/**
+	 *  @brief Returns the i-th action of the hand.
+	 */
+	ActionType
+	action (int i) const { return ActionType((history >> (2*i)) & 3); }
+
+	/**
+	 *  @brief Adds a card to the board.
+	 */
+	void
+	addCard (int id) { board |= 1ULL << id; }
+};
+
+static_assert(std::is_trivially_copyable<GameView>::value,
+		"GameView must be trivially copyable");
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef _HASH_H_
+#define _HASH_H_
+
+#include <cstddef>
+
+/**
+ *  @brief Parameters of the 64 bit FNV-1a hash.
+ */
+#define HASH_OFFSET 14695981039346656037ULL
+#define HASH_PRIME 1099511628211ULL
+
+/**
+ *  @brief Hashes a block of memory.
+ *
+ *  @param data First byte of the block.
+ *  @param n Size of the block in bytes.
+ *  @param h Hash of the data that precedes the block, if any.
+ */
+inline unsigned long long
+hashBytes (const void* data, size_t n, unsigned long long h = HASH_OFFSET){
+	const unsigned char* ptr = (const unsigned char*) data;
+	for (size_t i=0; i<n; i++){
+		h ^= ptr[i];
+		h *= HASH_PRIME;
+	}
+	return h;
+}
+
+/**
+ *  @brief Hashes a plain value.
+ *
+ *  @param value Value to be hashed.
+ *  @param h Hash of the data that precedes the value, if any.
+ */
+template <class T>
+inline unsigned long long
+hashValue (const T& value, unsigned long long h = HASH_OFFSET){
+	return hashBytes(&value, sizeof(T), h);
+}
+
+#endif
@@ -0,0 +1,99 @@
+#include "history.h"
+
+HandHistoryRecorder::HandHistoryRecorder (std::ostream& out) :
+	_o(out),
+	_filling(&_buffers[0]),
+	_writing(&_buffers[1]),
+	_done(false),
+	_recorded(0)
+{
+	unsigned int header[3] = {HISTORY_MAGIC, HISTORY_VERSION, sizeof(HandRecord)};
+	_o.write((const char*) header, sizeof(header));
+
+	_buffers[0].reserve(HISTORY_BUFFER_RECORDS);
+	_buffers[1].reserve(HISTORY_BUFFER_RECORDS);
+
+	_thread = std::thread(&HandHistoryRecorder::writer, this);
+}
+
+HandHistoryRecorder::~HandHistoryRecorder (){
+	flush();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_done = true;
+	}
+	_full.notify_one();
+	_thread.join();
+}
+
+void
+HandHistoryRecorder::handPlayed (const HandRecord& record){
+	std::unique_lock<std::mutex> lock(_mutex);
+	_filling->push_back(record);
+	_recorded++;
+	if (_filling->size() == HISTORY_BUFFER_RECORDS)
+		swap(lock);
+}
+
+void
+HandHistoryRecorder::flush (){
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (!_filling->empty())
+		swap(lock);
+	_free.wait(lock, [this]{ return _writing->empty(); });
+	_o.flush();
+}
+
+void
+HandHistoryRecorder::swap (std::unique_lock<std::mutex>& lock){
+	// The writer clears its buffer once it is on disk.
+	_free.wait(lock, [this]{ return _writing->empty(); });
+	std::swap(_filling, _writing);
+	_full.notify_one();
+}
+
+void
+HandHistoryRecorder::writer (){
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true){
+		_full.wait(lock, [this]{ return !_writing->empty() || _done; });
+		if (_writing->empty()) break;
+
+		// _writing is not swapped while it holds records, so it can be
+		// written without holding the lock.
+		std::vector<HandRecord>* buffer = _writing;
+		lock.unlock();
+		_o.write((const char*) buffer->data(), buffer->size()*sizeof(HandRecord));
+		lock.lock();
+
+		buffer->clear();
+		_free.notify_all();
+	}
+}
+
+HandHistoryReader::HandHistoryReader (std::istream& in) :
+	_i(in)
+{
+	unsigned int header[3];
+	_i.read((char*) header, sizeof(header));
+	_valid = _i.good() && header[0] == HISTORY_MAGIC &&
+			header[1] == HISTORY_VERSION && header[2] == sizeof(HandRecord);
+}
+
+bool
+HandHistoryReader::next (HandRecord& record){
+	if (!_valid) return false;
+	_i.read((char*) &record, sizeof(HandRecord));
+	return _i.gcount() == sizeof(HandRecord);
+}
+
+int
+HandHistoryReader::readAll (std::vector<HandRecord>& records){
+	int n = 0;
+	HandRecord record;
+	while (next(record)){
+		records.push_back(record);
+		n++;
+	}
+	return n;
+}
@@ -0,0 +1,199 @@
+#ifndef _HISTORY_H_
+#define _HISTORY_H_
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/**
+ *  @brief Number of seats stored in a hand record.
+ */
+#define HISTORY_SEATS 2
+
+/**
+ *  @brief Showdown shares are stored as integers out of SHARE_SCALE. It is
+ *  divisible by any number of players up to 9, so split pots are exact.
+ */
+#define SHARE_SCALE 2520
+
+/**
+ *  @brief Number of records kept in each of the buffers of the recorder.
+ */
+#define HISTORY_BUFFER_RECORDS 8192
+
+/**
+ *  @brief Identifies a hand history file.
+ */
+#define HISTORY_MAGIC 0x48484c4e
+#define HISTORY_VERSION 2
+
+/**
+ *  @brief Fixed-size packed record of a single hand.
+ *
+ *  Seats follow the order in which the players were passed to the PokerGame.
+ *  Cards are stored by their identifier. Only heads-up games are recorded.
+ */
+struct HandRecord {
+	/**
+	 *  @brief Actions of the hand, encoded as in GameView::history.
+	 */
+	unsigned long long history;
+
+	/**
+	 *  @brief Chips won or lost by each seat.
+	 */
+	short result[HISTORY_SEATS];
+
+	/**
+	 *  @brief Share of the pot each seat won at showdown, out of SHARE_SCALE.
+	 *  Only meaningful for the seats in %showdown.
+	 */
+	unsigned short share[HISTORY_SEATS];
+
+	unsigned char hole[HISTORY_SEATS][2];
+	unsigned char board[5];
+
+	unsigned char nseats;
+
+	/**
+	 *  @brief Seat holding the button, which posts the small blind heads-up.
+	 */
+	unsigned char dealer;
+	unsigned char effectiveStack;
+
+	/**
+	 *  @brief Number of actions stored in %history.
+	 */
+	unsigned char nactions;
+
+	/**
+	 *  @brief Seats that reached the showdown. Bit i is set for seat i. It is
+	 *  zero if the hand ended with a fold.
+	 */
+	unsigned char showdown;
+} __attribute__((packed));
+
+/**
+ *  @brief Base class for an observer expecting game events.
+ */
+class GameObserver {
+public:
+	virtual
+	~GameObserver () {}
+
+	/**
+	 *  @brief Event raised every time a hand is finished.
+	 *
+	 *  @param record The whole hand. It is only valid during the call.
+	 */
+	virtual void
+	handPlayed (const HandRecord& record) = 0;
+};
+
+/**
+ *  @brief Records every hand played to an output stream.
+ *
+ *  Records are gathered in memory and written by a background thread while
+ *  the game keeps filling a second buffer, so the game thread never waits for
+ *  the disk unless it outruns it. The same recorder may be attached to games
+ *  running in different threads.
+ */
+class HandHistoryRecorder : public GameObserver {
+public:
+	/**
+	 *  @brief Creates the recorder and writes the file header.
+	 *
+	 *  @param out Binary stream where the records will be placed.
+	 */
+	HandHistoryRecorder (std::ostream& out);
+
+	/**
+	 *  @brief Writes any pending record and stops the writer thread.
+	 */
+	~HandHistoryRecorder ();
+
+	/**
+	 *  Event. Inherited from GameObserver. Stores the record.
+	 */
+	void
+	handPlayed (const HandRecord& record);
+
+	/**
+	 *  @brief Blocks until every record received so far has been written.
+	 */
+	void
+	flush ();
+
+	/**
+	 *  @brief Returns the number of records received so far.
+	 */
+	unsigned long int
+	recorded () const { return _recorded; }
+
+private:
+	void writer ();
+	void swap (std::unique_lock<std::mutex>& lock);
+
+	std::ostream& _o;
+
+	std::vector<HandRecord> _buffers[2];
+	std::vector<HandRecord>* _filling;
+	std::vector<HandRecord>* _writing;
+
+	std::mutex _mutex;
+	std::condition_variable _full, _free;
+	bool _done;
+
+	/**
+	 *  Incremented under %_mutex, but read without it by recorded().
+	 */
+	std::atomic<unsigned long int> _recorded;
+
+	std::thread _thread;
+};
+
+/**
+ *  @brief Reads the records written by a HandHistoryRecorder.
+ */
+class HandHistoryReader {
+public:
+	/**
+	 *  @brief Creates the reader and checks the file header.
+	 *
+	 *  @param in Binary stream to read from.
+	 */
+	HandHistoryReader (std::istream& in);
+
+	/**
+	 *  @brief Returns false if the stream does not contain a hand history.
+	 */
+	bool
+	valid () const { return _valid; }
+
+	/**
+	 *  @brief Reads the next record.
+	 *
+	 *  @param record Where the record will be stored.
+	 *  @return false when there are no more records.
+	 */
+	bool
+	next (HandRecord& record);
+
+	/**
+	 *  @brief Reads all the remaining records.
+	 *
+	 *  @param records Vector to which the records are appended.
+	 *  @return The number of records read.
+	 */
+	int
+	readAll (std::vector<HandRecord>& records);
+
+private:
+	std::istream& _i;
+	bool _valid;
+};
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef _IO_H_
+#define _IO_H_
+
+#include <cerrno>
+#include <cstddef>
+#include <csignal>
+#include <ctime>
+#include <chrono>
+#include <algorithm>
+
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+/**
+ *  @brief Writes to a pipe with SIGPIPE blocked in the calling thread, so
+ *  that a reader that is gone makes it fail with EPIPE. A SIGPIPE raised by
+ *  the write is taken before unblocking it; one that was already pending is
+ *  left alone.
+ */
+inline ssize_t
+writeNoSignal (int fd, const char* data, size_t n){
+	sigset_t blocked, old, pending;
+	sigemptyset(&blocked);
+	sigaddset(&blocked, SIGPIPE);
+	sigpending(&pending);
+	bool wasPending = sigismember(&pending, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &blocked, &old);
+
+	ssize_t w = write(fd, data, n);
+	int error = errno;
+
+	if (w < 0 && error == EPIPE && !wasPending){
+		struct timespec zero = {0, 0};
+		while (sigtimedwait(&blocked, NULL, &zero) < 0 && errno == EINTR);
+	}
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	errno = error;
+	return w;
+}
+
+/**
+ *  @brief Writes a whole block to a file descriptor, retrying after
+ *  interruptions and partial writes.
+ *
+ *  The disposition of SIGPIPE is not touched: sockets are written with
+ *  MSG_NOSIGNAL and other descriptors through writeNoSignal(), so a peer
+ *  that hangs up makes this fail instead of killing the process.
+ *
+ *  @return false if the descriptor failed.
+ */
+inline bool
+writeAll (int fd, const char* data, size_t n){
+	bool isSocket = true;
+	while (n){
+		ssize_t w = (isSocket) ? send(fd, data, n, MSG_NOSIGNAL) : writeNoSignal(fd, data, n);
+		if (w < 0){
+			if (errno == EINTR) continue;
+			if (isSocket && errno == ENOTSOCK){
+				isSocket = false;
+				continue;
+			}
+			return false;
+		}
+		data += w;
+		n -= w;
+	}
+	return true;
+}
+
+/**
+ *  @brief Reads a whole block from a file descriptor, retrying after
+ *  interruptions and partial reads.
+ *
+ *  @param timeout Milliseconds allowed for the whole block, or a negative
+ *  number to wait for as long as it takes.
+ *
+ *  @return false if the descriptor failed, reached its end or ran out of
+ *  time first.
+ */
+inline bool
+readAll (int fd, char* data, size_t n, int timeout=-1){
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+		+ std::chrono::milliseconds(std::max(timeout, 0));
+	while (n){
+		if (timeout >= 0){
+			long long left = std::chrono::duration_cast<std::chrono::milliseconds>(
+					deadline - std::chrono::steady_clock::now()).count();
+			struct pollfd p = {fd, POLLIN, 0};
+			int ready = poll(&p, 1, (int) std::max(left, 0LL));
+			if (ready < 0){
+				if (errno == EINTR) continue;
+				return false;
+			}
+			if (ready == 0) return false;
+		}
+
+		ssize_t r = read(fd, data, n);
+		if (r < 0){
+			if (errno == EINTR) continue;
+			return false;
+		}
+		if (r == 0) return false;
+		data += r;
+		n -= r;
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,207 @@
+#include "library.h"
+
+#include <sstream>
+#include <algorithm>
+#include <typeinfo>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ *  @brief Input buffer over a block of memory, so that players can read
+ *  themselves straight from the mapped file.
+ */
+class MemoryBuffer : public std::streambuf {
+public:
+	MemoryBuffer (const char* data, size_t n){
+		char* p = const_cast<char*>(data);
+		setg(p, p, p + n);
+	}
+};
+
+/**
+ *  @brief Returns the StrategyType of a player, or 0 if it cannot be stored.
+ */
+static unsigned int
+strategyType (const Player& p){
+	const std::type_info& type = typeid(p);
+	if (type == typeid(RCTPlayer)) return STRATEGY_RCT;
+	if (type == typeid(RCPlayer)) return STRATEGY_RC;
+	if (type == typeid(PlayerChart)) return STRATEGY_CHART;
+	if (type == typeid(MixedPlayer)) return STRATEGY_MIXED;
+	return 0;
+}
+
+bool
+StrategyLibraryWriter::add (const Player& p, unsigned int run, unsigned int generation,
+		float fitness){
+	unsigned int type = strategyType(p);
+	if (!type) return false;
+
+	std::map<unsigned long long,int>::iterator it = _index.find(p.hash());
+	if (it != _index.end()){
+		LibraryEntry& e = _entries[it->second];
+		if (fitness > e.fitness){
+			e.run = run;
+			e.generation = generation;
+			e.fitness = fitness;
+		}
+		return true;
+	}
+
+	std::ostringstream data;
+	p.writeResults(data);
+
+	LibraryEntry e;
+	e.hash = p.hash();
+	e.offset = 0;
+	e.size = data.str().size();
+	e.type = type;
+	e.run = run;
+	e.generation = generation;
+	e.fitness = fitness;
+
+	_index[e.hash] = _entries.size();
+	_entries.push_back(e);
+	_data.push_back(data.str());
+
+	return true;
+}
+
+/**
+ *  @brief Orders entries by decreasing fitness.
+ */
+struct FitterEntry {
+	const std::vector<LibraryEntry>* entries;
+
+	bool
+	operator() (int a, int b) const { return (*entries)[a].fitness > (*entries)[b].fitness; }
+};
+
+void
+StrategyLibraryWriter::write (std::ostream& out) const {
+	int n = _entries.size();
+
+	LibraryHeader header;
+	header.magic = LIBRARY_MAGIC;
+	header.version = LIBRARY_VERSION;
+	header.nentries = n;
+	header.nbuckets = 2;
+	while (header.nbuckets < 2u*n) header.nbuckets <<= 1;
+
+	std::vector<int> order(n);
+	for (int i=0; i<n; i++) order[i] = i;
+	FitterEntry fitter = {&_entries};
+	std::stable_sort(order.begin(), order.end(), fitter);
+
+	// Lay out the data after the entries.
+	std::vector<LibraryEntry> entries(n);
+	unsigned long long offset = sizeof(LibraryHeader) + header.nbuckets*sizeof(LibraryBucket)
+			+ n*sizeof(LibraryEntry);
+	for (int i=0; i<n; i++){
+		entries[i] = _entries[order[i]];
+		entries[i].offset = offset;
+		offset += entries[i].size;
+	}
+
+	// Open addressing with linear probing.
+	std::vector<LibraryBucket> buckets(header.nbuckets);
+	for (unsigned int b=0; b<header.nbuckets; b++){
+		buckets[b].hash = 0;
+		buckets[b].entry = 0;
+	}
+	for (int i=0; i<n; i++){
+		unsigned int b = entries[i].hash & (header.nbuckets - 1);
+		while (buckets[b].entry) b = (b + 1) & (header.nbuckets - 1);
+		buckets[b].hash = entries[i].hash;
+		buckets[b].entry = i + 1;
+	}
+
+	out.write((const char*) &header, sizeof(header));
+	out.write((const char*) &buckets[0], header.nbuckets*sizeof(LibraryBucket));
+	if (n) out.write((const char*) &entries[0], n*sizeof(LibraryEntry));
+	for (int i=0; i<n; i++)
+		out.write(_data[order[i]].data(), _data[order[i]].size());
+	out.flush();
+}
+
+StrategyLibrary::StrategyLibrary (const char* filename) :
+	_map(0),
+	_size(0),
+	_header(0),
+	_buckets(0),
+	_entries(0)
+{
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) return;
+
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size >= (off_t) sizeof(LibraryHeader)){
+		_size = st.st_size;
+		_map = mmap(0, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (_map == MAP_FAILED) _map = 0;
+	}
+	close(fd);
+	if (!_map) return;
+
+	const char* base = (const char*) _map;
+	const LibraryHeader* header = (const LibraryHeader*) base;
+	unsigned long long tables = sizeof(LibraryHeader)
+			+ (unsigned long long) header->nbuckets*sizeof(LibraryBucket)
+			+ (unsigned long long) header->nentries*sizeof(LibraryEntry);
+	if (header->magic != LIBRARY_MAGIC || header->version != LIBRARY_VERSION
+			|| header->nbuckets == 0 || (header->nbuckets & (header->nbuckets - 1))
+			|| tables > _size)
+		return;
+
+	_buckets = (const LibraryBucket*) (base + sizeof(LibraryHeader));
+	_entries = (const LibraryEntry*) (_buckets + header->nbuckets);
+	_header = header;
+}
+
+StrategyLibrary::~StrategyLibrary (){
+	if (_map) munmap(_map, _size);
+}
+
+int
+StrategyLibrary::find (unsigned long long hash) const {
+	if (!_header) return -1;
+
+	unsigned int mask = _header->nbuckets - 1;
+	for (unsigned int b = hash & mask; _buckets[b].entry; b = (b + 1) & mask)
+		if (_buckets[b].hash == hash)
+			return _buckets[b].entry - 1;
+
+	return -1;
+}
+
+Player*
+StrategyLibrary::load (int i) const {
+	const LibraryEntry& e = _entries[i];
+	if (e.offset + e.size > _size) return NULL;
+
+	Player* p;
+	switch (e.type){
+	case STRATEGY_RCT: p = new RCTPlayer(); break;
+	case STRATEGY_RC: p = new RCPlayer(); break;
+	case STRATEGY_CHART: p = new PlayerChart(); break;
+	case STRATEGY_MIXED: p = new MixedPlayer(); break;
+	default: return NULL;
+	}
+
+	MemoryBuffer buffer((const char*) _map + e.offset, e.size);
+	std::istream in(&buffer);
+	p->readResults(in);
+
+	return p;
+}
+
+void
+StrategyLibrary::loadBest (int n, std::vector<Player*>& players) const {
+	for (int i=0; i<n && i<size(); i++){
+		Player* p = load(i);
+		if (p) players.push_back(p);
+	}
+}
@@ -0,0 +1,197 @@
+#ifndef _LIBRARY_H_
+#define _LIBRARY_H_
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+
+#include "player.h"
+
+/**
+ *  @brief Identifies a strategy library file.
+ */
+#define LIBRARY_MAGIC 0x4c53484e
+#define LIBRARY_VERSION 1
+
+/**
+ *  @brief Kind of player stored in a library entry.
+ */
+enum StrategyType {
+	STRATEGY_RCT=1,
+	STRATEGY_RC,
+	STRATEGY_CHART,
+	STRATEGY_MIXED
+};
+
+/**
+ *  @brief Header at the beginning of a library file.
+ */
+struct LibraryHeader {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int nentries;
+
+	/**
+	 *  @brief Number of slots of the hash index. It is a power of two.
+	 */
+	unsigned int nbuckets;
+} __attribute__((packed));
+
+/**
+ *  @brief Description of a strategy stored in a library.
+ */
+struct LibraryEntry {
+	/**
+	 *  @brief Player::hash() of the strategy.
+	 */
+	unsigned long long hash;
+
+	/**
+	 *  @brief Position of the player's data, from the beginning of the file.
+	 */
+	unsigned long long offset;
+	unsigned int size;
+
+	/**
+	 *  @brief A StrategyType.
+	 */
+	unsigned int type;
+
+	/**
+	 *  @brief Identifier of the run that produced the strategy.
+	 */
+	unsigned int run;
+	unsigned int generation;
+	float fitness;
+} __attribute__((packed));
+
+/**
+ *  @brief Slot of the hash index. %entry is one more than the position of
+ *  the entry, zero for empty slots.
+ */
+struct LibraryBucket {
+	unsigned long long hash;
+	unsigned int entry;
+} __attribute__((packed));
+
+/**
+ *  @brief Gathers strategies and writes them as a library.
+ *
+ *  A library file holds the header, the hash index, the entries sorted by
+ *  decreasing fitness and then the data of every player, as written by
+ *  Player::writeResults. A strategy added twice is stored once, with the
+ *  metadata of its fittest copy.
+ */
+class StrategyLibraryWriter {
+public:
+	/**
+	 *  @brief Adds a strategy.
+	 *
+	 *  @param p The player. Only RCTPlayer, RCPlayer, PlayerChart and
+	 *  MixedPlayer can be stored.
+	 *  @param run Identifier of the run that produced it.
+	 *  @param generation Generation in which it was found.
+	 *  @param fitness Its score.
+	 *  @return false if the type of the player cannot be stored.
+	 */
+	bool
+	add (const Player& p, unsigned int run, unsigned int generation, float fitness);
+
+	/**
+	 *  @brief Writes the library.
+	 *
+	 *  @param out Binary stream where the library will be placed.
+	 */
+	void
+	write (std::ostream& out) const;
+
+	/**
+	 *  @brief Returns the number of different strategies added so far.
+	 */
+	int
+	size () const { return _entries.size(); }
+
+private:
+	std::vector<LibraryEntry> _entries;
+	std::vector<std::string> _data;
+	std::map<unsigned long long,int> _index;
+};
+
+/**
+ *  @brief Read only view of a library file.
+ *
+ *  The file is memory mapped, so opening it costs the same no matter its
+ *  size and players are only decoded when loaded. Several threads may use
+ *  the same library.
+ */
+class StrategyLibrary {
+public:
+	/**
+	 *  @brief Maps a library file.
+	 *
+	 *  @param filename Path of the library.
+	 */
+	StrategyLibrary (const char* filename);
+
+	/**
+	 *  @brief Unmaps the file.
+	 */
+	~StrategyLibrary ();
+
+	/**
+	 *  @brief Returns false if the file could not be mapped or is not a
+	 *  library.
+	 */
+	bool
+	valid () const { return _header != 0; }
+
+	/**
+	 *  @brief Returns the number of strategies.
+	 */
+	int
+	size () const { return (_header) ? _header->nentries : 0; }
+
+	/**
+	 *  @brief Returns the description of a strategy. Entries are sorted by
+	 *  decreasing fitness.
+	 */
+	const LibraryEntry&
+	entry (int i) const { return _entries[i]; }
+
+	/**
+	 *  @brief Returns the position of the strategy with a given hash, or -1 if
+	 *  it is not in the library.
+	 */
+	int
+	find (unsigned long long hash) const;
+
+	/**
+	 *  @brief Builds the player stored in an entry. The caller must take the
+	 *  responsibility of destroying it.
+	 */
+	Player*
+	load (int i) const;
+
+	/**
+	 *  @brief Builds the %n fittest players of the library.
+	 *
+	 *  @param n Number of players.
+	 *  @param players Vector to which the players are appended.
+	 */
+	void
+	loadBest (int n, std::vector<Player*>& players) const;
+
+private:
+	StrategyLibrary (const StrategyLibrary&);
+	StrategyLibrary& operator= (const StrategyLibrary&);
+
+	void* _map;
+	unsigned long long _size;
+
+	const LibraryHeader* _header;
+	const LibraryBucket* _buckets;
+	const LibraryEntry* _entries;
+};
+
+#endif
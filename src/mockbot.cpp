@@ -0,0 +1,77 @@
+/**
+ *  @file Minimal bot speaking the protocol of protocol.h, to test
+ *  ExternalPlayer and ExternalBot.
+ *
+ *  It goes all-in as small blind and calls the shove as big blind with the
+ *  strongest hands of the ranking, and checks or calls any other bet.
+ *
+ *  Usage: mockbot [portion of hands played, 0.5 by default]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <unistd.h>
+
+#include "protocol.h"
+#include "handutils.h"
+#include "io.h"
+
+static DecisionResponse
+decide (const DecisionRequest& r, double percent){
+	Card a(r.hand[0]), b(r.hand[1]);
+	int M = std::max(a.rank(), b.rank()), m = std::min(a.rank(), b.rank());
+	int position = (a.suit() == b.suit()) ? top[m][M] : top[M][m];
+	bool strong = position/(double)(NRANKS*NRANKS) < percent;
+
+	DecisionResponse d;
+	d.id = r.id;
+	d.to = 0;
+	if (r.view.street != Street::PREFLOP)
+		d.action = ActionType::CALL;
+	else if (r.view.role != PlayerRole::BB){
+		d.action = (strong) ? ActionType::RAISE : ActionType::FOLD;
+		d.to = r.view.effectiveStack;
+	}
+	else if (r.view.roundBet < r.view.effectiveStack)
+		d.action = ActionType::CALL;
+	else
+		d.action = (strong) ? ActionType::CALL : ActionType::FOLD;
+
+	if (d.action == ActionType::CALL) d.to = r.view.roundBet;
+	return d;
+}
+
+int
+main (int argc, char** argv){
+	double percent = (argc > 1) ? atof(argv[1]) : 0.5;
+
+	ProtocolHello hello;
+	if (!readAll(STDIN_FILENO, (char*) &hello, sizeof(hello)) || hello.magic != PROTOCOL_MAGIC
+			|| hello.version != PROTOCOL_VERSION)
+		return 1;
+	if (!writeAll(STDOUT_FILENO, (const char*) &hello, sizeof(hello))) return 1;
+
+	std::vector<DecisionRequest> requests;
+	std::vector<char> out;
+	BatchHeader header;
+	while (readAll(STDIN_FILENO, (char*) &header, sizeof(header))){
+		if (header.count > PROTOCOL_MAX_BATCH) return 1;
+
+		requests.resize(header.count);
+		if (header.count && !readAll(STDIN_FILENO, (char*) &requests[0], header.count*sizeof(DecisionRequest)))
+			return 1;
+
+		out.resize(sizeof(BatchHeader) + header.count*sizeof(DecisionResponse));
+		*(BatchHeader*) &out[0] = header;
+		for (unsigned int i=0; i<header.count; i++){
+			DecisionResponse d = decide(requests[i], percent);
+			memcpy(&out[sizeof(BatchHeader) + i*sizeof(DecisionResponse)], &d, sizeof(d));
+		}
+		if (!writeAll(STDOUT_FILENO, &out[0], out.size())) return 1;
+	}
+
+	return 0;
+}
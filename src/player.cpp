@@ -1,4 +1,8 @@
 #include "player.h"
+#include "equity.h"
+
+#include <typeinfo>
+#include <cstring>
 
 
 Player::Player() :
@@ -6,7 +10,8 @@ Player::Player() :
 	_acc(0),
 	_outcome(0),
 	_bet(0),
-	_ev(0),
+	_adjustment(0),
+	_ranking(),
 	_nhands(0),
 	observers(0),
 	_nsb(0),
@@ -15,28 +20,58 @@ Player::Player() :
 	_ncalled(0) {}
 
 void
-Player::update_ev (int quantity) {
+Player::update_ev (int quantity, double credited) {
 	_stack += quantity;
 	_acc += quantity;
-	_ev = (_ev*_nhands + quantity)/_nhands;
+	_adjustment += credited - quantity;
+	_results.add(credited);
 	if (quantity > 0) _outcome++;
 	else if (quantity < 0) _outcome--;
 	_nhands++;
 	notifyValueChanged(ev());
 }
 
-Action*
-Player::action(PokerGame* game) {
-	Action* a = caction(game);
-	if (_role == PlayerRole::SB){
-		_nsb++;
-		if (a->type() == ActionType::RAISE) _nraised++;
+double
+Player::controlledEv () const {
+	unsigned long int n = 0;
+	double sum = 0;
+	for (int r=0; r<NLUCKS*NROLES; r++){
+		n += _deals[r].count();
+		sum += _deals[r].count()*_deals[r].corrected();
 	}
-	else if (_role == PlayerRole::BB){
-		_nbb++;
-		if (a->type() == ActionType::CALL) _ncalled++;
+
+	return (n) ? (sum/n)/2 : 0;
+}
+
+double
+Player::controlledEvError () const {
+	unsigned long int n = 0;
+	double var = 0;
+	for (int r=0; r<NLUCKS*NROLES; r++){
+		n += _deals[r].count();
+		var += _deals[r].count()*_deals[r].residualVariance();
 	}
 
+	return (n) ? (sqrt(var)/n)/2 : 0;
+}
+
+unsigned long long
+Player::hash () const {
+	const char* name = typeid(*this).name();
+	return hashBytes(name, strlen(name));
+}
+
+Action*
+Player::action(const GameView& view) {
+	Action* a = caction(view);
+	PlayerRole role = pushFoldRole(view);
+	if (role == PlayerRole::SB)
+		countDecision(role, a->type() == ActionType::RAISE,
+				handToNumeric(_hand[0],_hand[1]), view.effectiveStack);
+	else
+		countDecision(role, a->type() == ActionType::CALL,
+				handToNumeric(_hand[0],_hand[1]), view.effectiveStack);
+
 	return a;
 }
 
@@ -47,25 +82,22 @@ Player::notifyValueChanged (double value){
 }
 
 Action*
-PlayerAlwaysIn::caction(PokerGame* game){
-	if (_role == PlayerRole::SB)
-		return new Action(ActionType::RAISE,game->effectiveStack());
+PlayerAlwaysIn::caction(const GameView& view){
+	if (pushFoldRole(view) == PlayerRole::SB)
+		return new Action(ActionType::RAISE,view.effectiveStack);
 	else
-		return new Action(ActionType::CALL,game->roundBet());
+		return new Action(ActionType::CALL,view.roundBet);
 }
 
 bool
 PlayerAlwaysIn::equal (const Player& other){
 	if (this == &other) return true;
 
-	try { dynamic_cast<const PlayerAlwaysIn&>(other); }
-	catch (std::bad_cast& e) {return false;}
-
-	return true;
+	return typeid(other) == typeid(PlayerAlwaysIn);
 }
 
 Action*
-PlayerAlwaysOut::caction(PokerGame* game){
+PlayerAlwaysOut::caction(const GameView& view){
 	return new Action(ActionType::FOLD,0);
 }
 
@@ -73,23 +105,22 @@ bool
 PlayerAlwaysOut::equal (const Player& other){
 	if (this == &other) return true;
 
-	try { dynamic_cast<const PlayerAlwaysOut&>(other); }
-	catch (std::bad_cast& e) {return false;}
-
-	return true;
+	return typeid(other) == typeid(PlayerAlwaysOut);
 }
 
 Action*
-PlayerNash::caction(PokerGame* game){
-	if (_role == PlayerRole::SB){
-		if (game->effectiveStack() <= sb_max_stack[_hand[0].rank()][_hand[1].rank()])
-			return new Action(ActionType::RAISE,game->effectiveStack());
+PlayerNash::caction(const GameView& view){
+	// Charts are indexed like handToNumeric: suited hands above the diagonal.
+	int h = handToNumeric(_hand[0],_hand[1]);
+	if (pushFoldRole(view) == PlayerRole::SB){
+		if (view.effectiveStack <= sb_max_stack[h/NRANKS][h%NRANKS])
+			return new Action(ActionType::RAISE,view.effectiveStack);
 		else
 			return new Action(ActionType::FOLD,0);
 	}
 	else {
-		if (game->effectiveStack() <= bb_max_stack[_hand[0].rank()][_hand[1].rank()])
-			return new Action(ActionType::CALL,game->roundBet());
+		if (view.effectiveStack <= bb_max_stack[h/NRANKS][h%NRANKS])
+			return new Action(ActionType::CALL,view.roundBet);
 		else
 			return new Action(ActionType::FOLD,0);
 	}
@@ -99,25 +130,57 @@ bool
 PlayerNash::equal (const Player& other){
 	if (this == &other) return true;
 
-	try { dynamic_cast<const PlayerNash&>(other); }
-	catch (std::bad_cast& e) {return false;}
+	return typeid(other) == typeid(PlayerNash);
+}
+
+PlayerNashChart::PlayerNashChart (const ChartDatabase& db, int sb, int bb, int ante) :
+	Player ()
+{
+	int i = db.find(sb, bb, ante);
+	_valid = i >= 0;
+	if (_valid) _chart = db.chart(i);
 
-	return true;
+	_hash = hashBytes(_chart.masks(), CHART_WORDS*sizeof(unsigned long long), Player::hash());
 }
 
 Action*
-PlayerRaiseFoldPercent::caction (PokerGame* game){
-	if (_role == PlayerRole::SB){
-		if (handPercent(_hand[0],_hand[1]) < _r){
-			return new Action(ActionType::RAISE,game->effectiveStack());
-		}
+PlayerNashChart::caction (const GameView& view){
+	int h = handToNumeric(_hand[0], _hand[1]);
+	PlayerRole role = pushFoldRole(view);
+	if (role == PlayerRole::SB){
+		if (_chart.aggressive(role,view.effectiveStack,h))
+			return new Action(ActionType::RAISE,view.effectiveStack);
 		else
 			return new Action(ActionType::FOLD,0);
 	}
 	else {
-		if (handPercent(_hand[0],_hand[1]) < _c){
-			return new Action(ActionType::CALL,game->roundBet());
-		}
+		if (_chart.aggressive(role,view.effectiveStack,h))
+			return new Action(ActionType::CALL,view.roundBet);
+		else
+			return new Action(ActionType::FOLD,0);
+	}
+}
+
+bool
+PlayerNashChart::equal (const Player& other){
+	if (this == &other) return true;
+
+	return typeid(other) == typeid(PlayerNashChart) && other.hash() == _hash;
+}
+
+Action*
+PlayerRaiseFoldPercent::caction (const GameView& view){
+	int h = handToNumeric(_hand[0],_hand[1]);
+	PlayerRole role = pushFoldRole(view);
+	if (role == PlayerRole::SB){
+		if (_compiled.aggressive(role,view.effectiveStack,h))
+			return new Action(ActionType::RAISE,view.effectiveStack);
+		else
+			return new Action(ActionType::FOLD,0);
+	}
+	else {
+		if (_compiled.aggressive(role,view.effectiveStack,h))
+			return new Action(ActionType::CALL,view.roundBet);
 		else
 			return new Action(ActionType::FOLD,0);	
 	}
@@ -127,26 +190,32 @@ bool
 PlayerRaiseFoldPercent::equal (const Player& other){
 	if (this == &other) return true;
 
-	try {
-		const PlayerRaiseFoldPercent& o = dynamic_cast<const PlayerRaiseFoldPercent&>(other);
-		if (o._r == _r && o._c == _c)
-			return true;
-		else return false;
-	}
-	catch (std::bad_cast& e) {return false;}
+	if (typeid(other) != typeid(PlayerRaiseFoldPercent)) return false;
+
+	const PlayerRaiseFoldPercent& o = static_cast<const PlayerRaiseFoldPercent&>(other);
+	if (o._r == _r && o._c == _c)
+		return true;
+	else return false;
+}
+
+unsigned long long
+PlayerRaiseFoldPercent::hash () const {
+	return hashValue(_c, hashValue(_r, Player::hash()));
 }
 
 Action*
-RCPlayer::caction (PokerGame* game){
-	if (_role == PlayerRole::SB){
-		if (handPercent(_hand[0],_hand[1]) < r())
-			return new Action(ActionType::RAISE,game->effectiveStack());
+RCPlayer::caction (const GameView& view){
+	int h = handToNumeric(_hand[0],_hand[1]);
+	PlayerRole role = pushFoldRole(view);
+	if (role == PlayerRole::SB){
+		if (_compiled.aggressive(role,view.effectiveStack,h))
+			return new Action(ActionType::RAISE,view.effectiveStack);
 		else
 			return new Action(ActionType::FOLD,0);
 	}
 	else {
-		if (handPercent(_hand[0],_hand[1]) < c())
-			return new Action(ActionType::CALL,game->roundBet());
+		if (_compiled.aggressive(role,view.effectiveStack,h))
+			return new Action(ActionType::CALL,view.roundBet);
 		else
 			return new Action(ActionType::FOLD,0);
 	}
@@ -156,16 +225,32 @@ bool
 RCPlayer::equal (const Player& other){
 	if (this == &other) return true;
 
-	try {
-		const RCPlayer& o = dynamic_cast<const RCPlayer&>(other);
-		float norm = 0;
-		for (int i=0; i<length(); i++)
-			norm += fabs(gene(i) - o.gene(i));
+	// Same test as the match cache, which is keyed by the hash.
+	return typeid(other) == typeid(RCPlayer) && other.hash() == _hash;
+}
 
-		if (norm < 0.02) return true;
-		else return false;
-	}
-	catch (std::bad_cast& e){ return false; }
+/**
+ *  Recompiles the genome if it is a RCPlayer.
+ */
+static void
+compileIfPlayer (GAGenome* g){
+	RCPlayer* p = dynamic_cast<RCPlayer*>(g);
+	if (p) p->compile();
+}
+
+int
+RCPlayer::SwapMutator (GAGenome& c, float pmut){
+	int n = GA1DArrayGenome<float>::SwapMutator(c, pmut);
+	if (n) compileIfPlayer(&c);
+	return n;
+}
+
+int
+RCPlayer::OnePointCrossover (const GAGenome& p1, const GAGenome& p2, GAGenome* c1, GAGenome* c2){
+	int n = GA1DArrayGenome<float>::OnePointCrossover(p1, p2, c1, c2);
+	compileIfPlayer(c1);
+	compileIfPlayer(c2);
+	return n;
 }
 
 void
@@ -174,23 +259,29 @@ RCPlayer::init (GAGenome& g){
 	GARandomSeed();
 	genome.gene(0,GARandomFloat(0,1));
 	genome.gene(1,GARandomFloat(0,1));
+
+	RCPlayer* p = dynamic_cast<RCPlayer*>(&g);
+	if (p) p->compile();
 }
 
 RCTPlayer::RCTPlayer() :
-	GA3DArrayGenome(NRANKS,NRANKS,2),
-	Player ()
+	GAGenome(init, SwapMutator, HammingComparator),
+	Player (),
+	_compiled(NULL)
 {
-	initializer(init);
 	crossover(mergeCrossover);
+	memset(_words, 0, sizeof(_words));
+	compile();
 }
 
 
 RCTPlayer::RCTPlayer (float raise, float call) :
-	GA3DArrayGenome(NRANKS,NRANKS,2),
-	Player ()
+	GAGenome(init, SwapMutator, HammingComparator),
+	Player (),
+	_compiled(NULL)
 {
-	initializer(init);
 	crossover(mergeCrossover);
+	memset(_words, 0, sizeof(_words));
 
 	for (int i=0;i<this->width(); i++)
 		for (int j=0;j<this->height(); j++){
@@ -200,6 +291,65 @@ RCTPlayer::RCTPlayer (float raise, float call) :
 			if (handPercentTableCoords(i,j) < call) gene(i,j,1,20);
 			else gene(i,j,1,0);
 		}
+
+	compile();
+}
+
+void
+RCTPlayer::compile (){
+	_hash = hashBytes(_words, sizeof(_words), hashValue(classID()));
+	delete _compiled.exchange(NULL);
+}
+
+const CompiledStrategy&
+RCTPlayer::compiled () const {
+	CompiledStrategy* s = _compiled.load(std::memory_order_acquire);
+	if (s) return *s;
+
+	// Only the first use after a change gets here.
+	static std::mutex lock;
+	std::lock_guard<std::mutex> guard(lock);
+	s = _compiled.load(std::memory_order_relaxed);
+	if (s) return *s;
+
+	int raise[NHANDS], call[NHANDS];
+	for (int h=0; h<NHANDS; h++){
+		raise[h] = genes()[h];
+		call[h] = genes()[NHANDS + h];
+	}
+
+	s = new CompiledStrategy();
+	s->compileMaxStacks(PlayerRole::SB,raise);
+	s->compileMaxStacks(PlayerRole::BB,call);
+	_compiled.store(s, std::memory_order_release);
+	return *s;
+}
+
+int
+RCTPlayer::write (std::ostream& out) const {
+	for (int k=0; k<depth(); k++){
+		for (int i=0; i<width(); i++){
+			for (int j=0; j<height(); j++)
+				out << gene(i,j,k) << " ";
+			out << "\n";
+		}
+		out << "\n";
+	}
+	return out.fail() ? 1 : 0;
+}
+
+int
+RCTPlayer::read (std::istream& in){
+	for (int k=0; k<depth(); k++)
+		for (int i=0; i<width(); i++)
+			for (int j=0; j<height(); j++){
+				int g;
+				if (!(in >> g)) return 1;
+				gene(i,j,k,g);
+			}
+
+	compile();
+	return 0;
 }
 
 char*
@@ -219,44 +369,47 @@ RCTPlayer::desc (char* buffer) const {
 bool
 RCTPlayer::equal (const Player& other){
 	if (this == &other) return true;
-	else return false;
 
-	/* Norm comparator
-	int norm = 0;
-	for (int i=0; i<width(); i++)
-		for (int j=0; j<height(); j++)
-			for (int k=0; k<depth(); k++)
-				norm += abs(gene(i,j,k) - o.gene(i,j,k));
+	return typeid(other) == typeid(RCTPlayer) && other.hash() == _hash;
+}
 
-	if (norm <= 1) return true;
-	else return false;*/
+int
+RCTPlayer::equal (const GAGenome& other) const {
+	if (this == &other) return 1;
+
+	const RCTPlayer* o = dynamic_cast<const RCTPlayer*>(&other);
+	return o && !memcmp(_words, o->_words, sizeof(_words));
 }
 
 void
 RCTPlayer::init (GAGenome& g){
 	GARandomSeed();
-	GA3DArrayGenome<int>& genome = dynamic_cast<GA3DArrayGenome<int>&>(g);
+	RCTPlayer& genome = DYN_CAST(RCTPlayer&,g);
 	for (int i=0;i<genome.width(); i++)
 		for (int j=0;j<genome.height(); j++)
 			for (int k=0;k<genome.depth(); k++){
 				genome.gene(i,j,k,GARandomInt(3,20));
 			}
+
+	genome.compile();
 }
 
 //Constant!!
 void
 RCTPlayer::AllOrNothingInitializer (GAGenome& g){
-	GA3DArrayGenome<int>& genome = dynamic_cast<GA3DArrayGenome<int>&>(g);
+	RCTPlayer& genome = DYN_CAST(RCTPlayer&,g);
 	for (int i=0;i<genome.width(); i++)
 		for (int j=0;j<genome.height(); j++)
 			for (int k=0;k<genome.depth(); k++){
 				genome.gene(i,j,k,20*GARandomInt(0,1));
 			}
+
+	genome.compile();
 }
 
 void
 RCTPlayer::raiseCallInitializer (GAGenome& g){
-	GA3DArrayGenome<int>& genome = dynamic_cast<GA3DArrayGenome<int>&>(g);
+	RCTPlayer& genome = DYN_CAST(RCTPlayer&,g);
 	float raise = GARandomFloat(0,1);
 	float call = GARandomFloat(0,1);
 
@@ -268,82 +421,674 @@ RCTPlayer::raiseCallInitializer (GAGenome& g){
 			if (handPercentTableCoords(i,j) < call) genome.gene(i,j,1,20);
 			else genome.gene(i,j,1,0);
 		}
+
+	genome.compile();
+}
+
+/**
+ *  Returns the number of failures before the next success of a coin that
+ *  lands heads with probability p. Skipping that many parameters visits the
+ *  same ones as flipping the coin for each of them.
+ */
+static int
+geometricSkip (float p){
+	if (p >= 1) return 0;
+	return (int) (log(1 - GARandomFloat())/log(1 - p));
 }
 
 int
 RCTPlayer::mergeCrossover(const GAGenome& p1, const GAGenome& p2, GAGenome* c1, GAGenome* c2){
 	float pSwap = 0.03;
-	const GA3DArrayGenome<int>& mom = dynamic_cast<const GA3DArrayGenome<int>&>(p1);
-	const GA3DArrayGenome<int>& dad = dynamic_cast<const GA3DArrayGenome<int>&>(p2);
-	GA3DArrayGenome<int>* sis = dynamic_cast<GA3DArrayGenome<int>*>(c1);
-	GA3DArrayGenome<int>* bro = dynamic_cast<GA3DArrayGenome<int>*>(c2);
+	const RCTPlayer& mom = DYN_CAST(const RCTPlayer&,p1);
+	const RCTPlayer& dad = DYN_CAST(const RCTPlayer&,p2);
+	RCTPlayer* sis = dynamic_cast<RCTPlayer*>(c1);
+	RCTPlayer* bro = dynamic_cast<RCTPlayer*>(c2);
 
 	int n = 0;
 	if (sis) n++;
 	if (bro) n++;
 
-	for (int k=0; k<mom.depth();k++){
+	// Bytes set in the mask are the parameters swapped between the parents.
+	unsigned long long mask[RCT_WORDS] = {0};
+	unsigned char* swapped = reinterpret_cast<unsigned char*>(mask);
+	for (int g = geometricSkip(pSwap); g < RCT_GENES; g += 1 + geometricSkip(pSwap))
+		swapped[g] = 0xff;
+
+	for (int w=0; w<RCT_WORDS; w++){
+		if (sis) sis->_words[w] = (mom._words[w] & ~mask[w]) | (dad._words[w] & mask[w]);
+		if (bro) bro->_words[w] = (dad._words[w] & ~mask[w]) | (mom._words[w] & mask[w]);
+	}
+
+	if (sis) sis->compile();
+	if (bro) bro->compile();
+
+	return n;
+}
+
+int
+RCTPlayer::SubtleMutator (GAGenome& c, float pmut){
+	RCTPlayer& genome = DYN_CAST(RCTPlayer&,c);
+	if (pmut <= 0) return 0;
+
+	int n = 0;
+	unsigned char* genes = genome.genes();
+	for (int g = geometricSkip(pmut); g < RCT_GENES; g += 1 + geometricSkip(pmut)){
+		int m = genes[g];
+		if (m==20) m -= GARandomInt(0,2);
+		else if (m==0) m += GARandomInt(0,2);
+		else {
+			m += (GARandomInt()) ? GARandomInt(0,2) : -GARandomInt(0,2);
+			if (m<0) m=0;
+			else if (m>20) m=20;
+		}
+
+		genes[g] = m;
+		n++;
+	}
+
+	if (n) genome.compile();
+
+	return n;
+}
+
+int
+RCTPlayer::SwapMutator (GAGenome& c, float pmut){
+	RCTPlayer& genome = DYN_CAST(RCTPlayer&,c);
+	if (pmut <= 0) return 0;
+
+	unsigned char* genes = genome.genes();
+	int last = RCT_GENES - 1;
+	float nMut = pmut*last;
+	if (nMut < 1){
+		nMut = 0;
+		for (int g = last; g >= 0; g--)
+			if (GAFlipCoin(pmut)){
+				std::swap(genes[g], genes[GARandomInt(0,last)]);
+				nMut++;
+			}
+	}
+	else
+		for (int n=0; n<nMut; n++)
+			std::swap(genes[GARandomInt(0,last)], genes[GARandomInt(0,last)]);
+
+	if (nMut) genome.compile();
+
+	return (int) nMut;
+}
+
+float
+RCTPlayer::HammingComparator (const GAGenome& a, const GAGenome& b){
+	const RCTPlayer& x = DYN_CAST(const RCTPlayer&,a);
+	const RCTPlayer& y = DYN_CAST(const RCTPlayer&,b);
+
+	int n = 0;
+	for (int w=0; w<RCT_WORDS; w++){
+		// Fold each byte that differs into its lowest bit.
+		unsigned long long d = x._words[w] ^ y._words[w];
+		d |= d >> 4;
+		d |= d >> 2;
+		d |= d >> 1;
+		n += __builtin_popcountll(d & 0x0101010101010101ULL);
+	}
+
+	return n/(float) RCT_GENES;
+}
+
+Action*
+RCTPlayer::caction (const GameView& view){
+	int h = handToNumeric(_hand[0], _hand[1]);
+	const CompiledStrategy& compiled = this->compiled();
+	PlayerRole role = pushFoldRole(view);
+	if (role == PlayerRole::SB){
+		if (compiled.aggressive(role,view.effectiveStack,h))
+			return new Action(ActionType::RAISE,view.effectiveStack);
+		else
+			return new Action(ActionType::FOLD,0);
+	}
+	else {
+		if (compiled.aggressive(role,view.effectiveStack,h))
+			return new Action(ActionType::CALL,view.roundBet);
+		else
+			return new Action(ActionType::FOLD,0);
+
+	}
+}
+
+MixedPlayer::MixedPlayer() :
+	GA3DArrayGenome(NRANKS,NRANKS,2*MIXED_NSTACKS),
+	Player (),
+	_hash(0)
+{
+	initializer(init);
+	crossover(mergeCrossover);
+	mutator(GaussianMutator);
+}
+
+MixedPlayer::MixedPlayer (float raise, float call) :
+	GA3DArrayGenome(NRANKS,NRANKS,2*MIXED_NSTACKS),
+	Player ()
+{
+	initializer(init);
+	crossover(mergeCrossover);
+	mutator(GaussianMutator);
+
+	for (int i=0;i<width(); i++)
+		for (int j=0;j<height(); j++)
+			for (int k=0;k<MIXED_NSTACKS; k++){
+				gene(i,j,k,(handPercentTableCoords(i,j) < raise) ? 1 : 0);
+				gene(i,j,MIXED_NSTACKS+k,(handPercentTableCoords(i,j) < call) ? 1 : 0);
+			}
+
+	rehash();
+}
+
+char*
+MixedPlayer::desc (char* buffer) const {
+	char* desc = buffer, *ptr = desc;
+	for (int i = 0; i<NRANKS; i++){
+		for (int j=0; j<NRANKS; j++){
+			float p = 0;
+			for (int k=0; k<MIXED_NSTACKS; k++)
+				p += gene(i,j,k);
+			ptr += sprintf(ptr,"%.2f ",p/MIXED_NSTACKS);
+		}
+		*ptr = '\n';ptr++;
+	}
+	*ptr = '\0';
+
+	return desc;
+}
+
+bool
+MixedPlayer::equal (const Player& other){
+	if (this == &other) return true;
+
+	return typeid(other) == typeid(MixedPlayer) && other.hash() == _hash;
+}
+
+void
+MixedPlayer::rehash (){
+	unsigned long long h = hashValue(classID());
+	for (int i=0; i<width(); i++)
+		for (int j=0; j<height(); j++)
+			for (int k=0; k<depth(); k++)
+				h = hashValue(gene(i,j,k), h);
+	_hash = h;
+}
+
+/**
+ *  Rehashes the genome if it is a MixedPlayer.
+ */
+static void
+rehashIfPlayer (GAGenome* g){
+	MixedPlayer* p = dynamic_cast<MixedPlayer*>(g);
+	if (p) p->rehash();
+}
+
+void
+MixedPlayer::init (GAGenome& g){
+	GA3DArrayGenome<float>& genome = dynamic_cast<GA3DArrayGenome<float>&>(g);
+	for (int i=0;i<genome.width(); i++)
+		for (int j=0;j<genome.height(); j++)
+			for (int k=0;k<genome.depth(); k++)
+				genome.gene(i,j,k,GARandomFloat(0,1));
+
+	rehashIfPlayer(&g);
+}
+
+void
+MixedPlayer::raiseCallInitializer (GAGenome& g){
+	GA3DArrayGenome<float>& genome = dynamic_cast<GA3DArrayGenome<float>&>(g);
+	float raise = GARandomFloat(0,1);
+	float call = GARandomFloat(0,1);
+
+	for (int i=0;i<genome.width(); i++)
+		for (int j=0;j<genome.height(); j++)
+			for (int k=0;k<MIXED_NSTACKS; k++){
+				genome.gene(i,j,k,(handPercentTableCoords(i,j) < raise) ? 1 : 0);
+				genome.gene(i,j,MIXED_NSTACKS+k,(handPercentTableCoords(i,j) < call) ? 1 : 0);
+			}
+
+	rehashIfPlayer(&g);
+}
+
+int
+MixedPlayer::mergeCrossover(const GAGenome& p1, const GAGenome& p2, GAGenome* c1, GAGenome* c2){
+	float pSwap = 0.03;
+	const GA3DArrayGenome<float>& mom = dynamic_cast<const GA3DArrayGenome<float>&>(p1);
+	const GA3DArrayGenome<float>& dad = dynamic_cast<const GA3DArrayGenome<float>&>(p2);
+	GA3DArrayGenome<float>* sis = dynamic_cast<GA3DArrayGenome<float>*>(c1);
+	GA3DArrayGenome<float>* bro = dynamic_cast<GA3DArrayGenome<float>*>(c2);
+
+	int n = 0;
+	if (sis) n++;
+	if (bro) n++;
+
+	// The shoving and calling probabilities of a hand are swapped as a whole.
+	for (int r=0; r<2; r++){
 		for (int i=0; i<mom.width();i++){
 			for (int j=0; j<mom.height();j++){
-				if (GAFlipCoin(pSwap)){
-					if(sis) sis->gene(i,j,k,dad.gene(i,j,k));
-					if (bro) bro->gene(i,j,k,mom.gene(i,j,k));
-				}
-				else {
-					if(sis) sis->gene(i,j,k,mom.gene(i,j,k));
-					if (bro) bro->gene(i,j,k, dad.gene(i,j,k));
+				bool swap = GAFlipCoin(pSwap);
+				const GA3DArrayGenome<float>& a = (swap) ? dad : mom;
+				const GA3DArrayGenome<float>& b = (swap) ? mom : dad;
+				for (int k=r*MIXED_NSTACKS; k<(r+1)*MIXED_NSTACKS; k++){
+					if (sis) sis->gene(i,j,k,a.gene(i,j,k));
+					if (bro) bro->gene(i,j,k,b.gene(i,j,k));
 				}
 			}
 		}
 	}
 
+	rehashIfPlayer(c1);
+	rehashIfPlayer(c2);
+
 	return n;
 }
 
 int
-RCTPlayer::SubtleMutator (GAGenome& c, float pmut){
-	GA3DArrayGenome<int>& genome = dynamic_cast<GA3DArrayGenome<int>&>(c);
+MixedPlayer::GaussianMutator (GAGenome& c, float pmut){
+	GA3DArrayGenome<float>& genome = dynamic_cast<GA3DArrayGenome<float>&>(c);
 	if (pmut <= 0) return 0;
 
 	int n = 0;
 	for (int i=0; i<genome.width(); i++)
-		for (int j=0; j<genome.height(); j++){
+		for (int j=0; j<genome.height(); j++)
 			for (int k=0; k<genome.depth(); k++){
 				if (GAFlipCoin(pmut)){
-					int m = genome.gene(i,j,k);
-					if (m==20) m -= GARandomInt(0,2);
-					else if (m==0) m += GARandomInt(0,2);
-					else {
-						m += (GARandomInt()) ? GARandomInt(0,2) : -GARandomInt(0,2);
-						if (m<0) m=0;
-						else if (m>20) m=20;
-					}
-
-					genome.gene(i,j,k,m);
+					float p = genome.gene(i,j,k) + 0.1*GAUnitGaussian();
+					if (p < 0) p = 0;
+					else if (p > 1) p = 1;
+
+					genome.gene(i,j,k,p);
 					n++;
 				}
 			}
+
+	if (n) rehashIfPlayer(&c);
+
+	return n;
+}
+
+bool
+MixedPlayer::draw (float p){
+	thread_local std::mt19937 generator(std::random_device{}());
+	// 24 random bits, the precision of a float.
+	return (generator() >> 8) < p*(1 << 24);
+}
+
+Action*
+MixedPlayer::caction (const GameView& view){
+	int h = handToNumeric(_hand[0], _hand[1]);
+	if (pushFoldRole(view) == PlayerRole::SB){
+		if (draw(shoveProbability(view.effectiveStack,h)))
+			return new Action(ActionType::RAISE,view.effectiveStack);
+		else
+			return new Action(ActionType::FOLD,0);
+	}
+	else {
+		if (draw(callProbability(view.effectiveStack,h)))
+			return new Action(ActionType::CALL,view.roundBet);
+		else
+			return new Action(ActionType::FOLD,0);
+	}
+}
+
+PostflopPlayer::PostflopPlayer() :
+	GA1DArrayGenome<float>(POSTFLOP_GENES),
+	Player (),
+	_hash(0)
+{
+	initializer(init);
+	mutator(GaussianMutator);
+	crossover(OnePointCrossover);
+}
+
+PostflopPlayer::PostflopPlayer (float play, float raise, float bet, float margin) :
+	GA1DArrayGenome<float>(POSTFLOP_GENES),
+	Player ()
+{
+	initializer(init);
+	mutator(GaussianMutator);
+	crossover(OnePointCrossover);
+
+	gene(0,play);
+	gene(1,raise);
+	for (int s=Street::FLOP; s<=Street::RIVER; s++){
+		gene(2*s,bet);
+		gene(2*s+1,margin);
+	}
+
+	rehash();
+}
+
+char*
+PostflopPlayer::desc (char* buffer) const {
+	char* ptr = buffer;
+	ptr += sprintf(ptr,"Play %.3f, raise %.3f",gene(0),gene(1));
+	for (int s=Street::FLOP; s<=Street::RIVER; s++)
+		ptr += sprintf(ptr,", bet/margin %.3f/%.3f",gene(2*s),gene(2*s+1));
+
+	return buffer;
+}
+
+bool
+PostflopPlayer::equal (const Player& other){
+	if (this == &other) return true;
+
+	return typeid(other) == typeid(PostflopPlayer) && other.hash() == _hash;
+}
+
+void
+PostflopPlayer::rehash (){
+	unsigned long long h = hashValue(classID());
+	for (int i=0; i<length(); i++)
+		h = hashValue(gene(i), h);
+	_hash = h;
+}
+
+void
+PostflopPlayer::init (GAGenome& g){
+	GA1DArrayGenome<float>& genome = dynamic_cast<GA1DArrayGenome<float>&>(g);
+	for (int i=0; i<genome.length(); i++)
+		genome.gene(i,GARandomFloat(0,1));
+
+	PostflopPlayer* p = dynamic_cast<PostflopPlayer*>(&g);
+	if (p) p->rehash();
+}
+
+int
+PostflopPlayer::GaussianMutator (GAGenome& c, float pmut){
+	GA1DArrayGenome<float>& genome = dynamic_cast<GA1DArrayGenome<float>&>(c);
+	if (pmut <= 0) return 0;
+
+	int n = 0;
+	for (int i=0; i<genome.length(); i++){
+		if (GAFlipCoin(pmut)){
+			float p = genome.gene(i) + 0.05*GAUnitGaussian();
+			if (p < 0) p = 0;
+			else if (p > 1) p = 1;
+
+			genome.gene(i,p);
+			n++;
 		}
+	}
+
+	PostflopPlayer* p = dynamic_cast<PostflopPlayer*>(&c);
+	if (n && p) p->rehash();
+
+	return n;
+}
+
+int
+PostflopPlayer::OnePointCrossover (const GAGenome& p1, const GAGenome& p2, GAGenome* c1, GAGenome* c2){
+	int n = GA1DArrayGenome<float>::OnePointCrossover(p1, p2, c1, c2);
+
+	PostflopPlayer* sis = dynamic_cast<PostflopPlayer*>(c1);
+	PostflopPlayer* bro = dynamic_cast<PostflopPlayer*>(c2);
+	if (sis) sis->rehash();
+	if (bro) bro->rehash();
 
 	return n;
 }
 
 Action*
-RCTPlayer::caction (PokerGame* game){
+PostflopPlayer::preflop (const GameView& view, int toCall){
+	double q = handPercent(_hand[0], _hand[1]);
+
+	// Only the blinds were posted.
+	if (view.roundBet <= 2){
+		if (q < gene(1))
+			return new Action(ActionType::RAISE,3*view.roundBet);
+		if (q < gene(0) || toCall == 0)
+			return new Action(ActionType::CALL,view.roundBet);
+		return new Action(ActionType::FOLD,0);
+	}
+
+	if (q < gene(1))
+		return new Action(ActionType::CALL,view.roundBet);
+	return new Action(ActionType::FOLD,0);
+}
+
+Action*
+PostflopPlayer::caction (const GameView& view){
+	int toCall = view.roundBet - _bet;
+	if (view.street == Street::PREFLOP) return preflop(view, toCall);
+
+	// Beating several random hands is taken as beating each one of them
+	// independently.
+	double equity = pow(boardEquity(_hand, view.board), view.nplaying - 1);
+	float threshold = gene(2*view.street), margin = gene(2*view.street+1);
+
+	if (equity >= threshold)
+		return new Action(ActionType::RAISE,view.roundBet + view.pot + toCall);
+	if (toCall == 0)
+		return new Action(ActionType::CALL,view.roundBet);
+	if (equity >= toCall/(double) (view.pot + toCall) + margin - 0.5)
+		return new Action(ActionType::CALL,view.roundBet);
+	return new Action(ActionType::FOLD,0);
+}
+
+PlayerChart::PlayerChart (){
+	memset(_chart, 0, sizeof(_chart));
+	compile();
+}
+
+PlayerChart::PlayerChart (const unsigned char* sb, const unsigned char* bb){
+	memcpy(_chart[0], sb, NHANDS);
+	memcpy(_chart[1], bb, NHANDS);
+	compile();
+}
+
+PlayerChart::PlayerChart (const RCTPlayer& p){
+	for (int h=0; h<NHANDS; h++){
+		_chart[0][h] = p.raiseTable(h/NRANKS,h%NRANKS);
+		_chart[1][h] = p.callTable(h/NRANKS,h%NRANKS);
+	}
+	compile();
+}
+
+void
+PlayerChart::compile (){
+	int sb[NHANDS], bb[NHANDS];
+	for (int h=0; h<NHANDS; h++){
+		sb[h] = _chart[0][h];
+		bb[h] = _chart[1][h];
+	}
+
+	_compiled.compileMaxStacks(PlayerRole::SB,sb);
+	_compiled.compileMaxStacks(PlayerRole::BB,bb);
+	_hash = hashBytes(_chart, sizeof(_chart), Player::hash());
+}
+
+char*
+PlayerChart::desc (char* buffer) const {
+	char* desc = buffer, *ptr = desc;
+	for (int i = 0; i<NRANKS; i++){
+		for (int j=0; j<NRANKS; j++){
+			ptr += sprintf(ptr,"%d ",_chart[0][i*NRANKS+j]);
+		}
+		*ptr = '\n';ptr++;
+	}
+	*ptr = '\0';
+
+	return desc;
+}
+
+bool
+PlayerChart::equal (const Player& other){
+	if (this == &other) return true;
+
+	return typeid(other) == typeid(PlayerChart) && other.hash() == _hash;
+}
+
+Action*
+PlayerChart::caction (const GameView& view){
 	int h = handToNumeric(_hand[0], _hand[1]);
-	int r = raiseTable(h/13,h%13);
-	int c = callTable(h/13,h%13);
-	if (_role == PlayerRole::SB){
-		if (game->effectiveStack() <= raiseTable(h/13,h%13)){
-			return new Action(ActionType::RAISE,game->effectiveStack());}
+	PlayerRole role = pushFoldRole(view);
+	if (role == PlayerRole::SB){
+		if (_compiled.aggressive(role,view.effectiveStack,h))
+			return new Action(ActionType::RAISE,view.effectiveStack);
 		else
 			return new Action(ActionType::FOLD,0);
 	}
 	else {
-		if(game->effectiveStack() <= callTable(h/13,h%13)){
-			return new Action(ActionType::CALL,game->roundBet());}
+		if (_compiled.aggressive(role,view.effectiveStack,h))
+			return new Action(ActionType::CALL,view.roundBet);
+		else
+			return new Action(ActionType::FOLD,0);
+	}
+}
+
+AdaptivePlayer::AdaptivePlayer (float prior) :
+	Player (),
+	_prior(prior)
+{
+	forget();
+}
+
+void
+AdaptivePlayer::forget (){
+	for (int r=0; r<2; r++)
+		for (int s=0; s<COMPILED_ROWS; s++){
+			_alpha[r][s] = _beta[r][s] = _prior/2;
+			_shown[r][s] = 0;
+			_range[r][s] = 0;
+		}
+
+	_decided.clear();
+	_valid.clear();
+
+	for (int s=0; s<COMPILED_ROWS; s++){
+		estimate(PlayerRole::SB, s);
+		estimate(PlayerRole::BB, s);
+	}
+}
+
+void
+AdaptivePlayer::handFinished (const GameView& view, const Card* shown){
+	if (view.nactions == 0) return;
+
+	// The opponent's role is the other one.
+	if (view.role == PlayerRole::BB){
+		if (view.action(0) == ActionType::CALL) return; // A limp tells nothing about shoves
+
+		observe(PlayerRole::SB, view.effectiveStack, view.action(0) == ActionType::RAISE);
+		if (shown) observeHand(PlayerRole::SB, view.effectiveStack, handToNumeric(shown[0],shown[1]));
+	}
+	else if (view.role == PlayerRole::SB){
+		if (view.action(0) != ActionType::RAISE || view.nactions < 2) return;
+
+		observe(PlayerRole::BB, view.effectiveStack, view.action(1) == ActionType::CALL);
+		if (shown) observeHand(PlayerRole::BB, view.effectiveStack, handToNumeric(shown[0],shown[1]));
+	}
+}
+
+void
+AdaptivePlayer::observe (int role, int stack, bool aggressive){
+	int r = role != PlayerRole::SB, s = CompiledStrategy::row(stack);
+	if (aggressive) _alpha[r][s]++;
+	else _beta[r][s]++;
+
+	estimate(role, s);
+}
+
+void
+AdaptivePlayer::observeHand (int role, int stack, int hand){
+	int r = role != PlayerRole::SB, s = CompiledStrategy::row(stack);
+	int position = top[hand/NRANKS][hand%NRANKS];
+	if (position > _shown[r][s]){
+		_shown[r][s] = position;
+		estimate(role, s);
+	}
+}
+
+void
+AdaptivePlayer::estimate (int role, int stack){
+	int r = role != PlayerRole::SB, s = CompiledStrategy::row(stack);
+	double mean = _alpha[r][s]/(_alpha[r][s] + _beta[r][s]);
+
+	// The posterior moves a little with every hand, so the range is searched
+	// from the previous one.
+	int k = std::max(_range[r][s], 1);
+	while (k < NHANDS && rangeWeight(k) < mean) k++;
+	while (k > 1 && rangeWeight(k-1) >= mean) k--;
+	k = std::max(k, _shown[r][s]);
+
+	if (k != _range[r][s]){
+		_range[r][s] = k;
+		// Only the decisions against this range are affected.
+		_valid.clear((r) ? PlayerRole::SB : PlayerRole::BB, s);
+	}
+}
+
+bool
+AdaptivePlayer::bestResponse (int role, int stack, int hand) const {
+	int k = range((role == PlayerRole::SB) ? PlayerRole::BB : PlayerRole::SB, stack);
+
+	// Chips won or lost if the hand goes to showdown, blinds included.
+	double allin = 2*stack*rangeEquity(hand, k) - stack;
+	if (role == PlayerRole::SB){
+		double called = rangeWeight(k);
+		return (1 - called)*2 + called*allin > -1;
+	}
+	else
+		return allin > -2;
+}
+
+bool
+AdaptivePlayer::play (int role, int stack, int hand){
+	// Bigger stacks share a row, but not the same best response.
+	if (stack > COMPILED_MAX_STACK) return bestResponse(role, stack, hand);
+
+	if (!_valid.aggressive(role, stack, hand)){
+		_decided.aggressive(role, stack, hand, bestResponse(role, stack, hand));
+		_valid.aggressive(role, stack, hand, true);
+	}
+
+	return _decided.aggressive(role, stack, hand);
+}
+
+Action*
+AdaptivePlayer::caction (const GameView& view){
+	if (view.street != Street::PREFLOP)
+		return new Action(ActionType::CALL,view.roundBet);
+
+	int h = handToNumeric(_hand[0], _hand[1]);
+	if (pushFoldRole(view) == PlayerRole::SB){
+		if (play(PlayerRole::SB,view.effectiveStack,h))
+			return new Action(ActionType::RAISE,view.effectiveStack);
 		else
 			return new Action(ActionType::FOLD,0);
+	}
+	else {
+		if (view.roundBet < view.effectiveStack)
+			return new Action(ActionType::CALL,view.roundBet);
 
+		if (play(PlayerRole::BB,view.effectiveStack,h))
+			return new Action(ActionType::CALL,view.roundBet);
+		else
+			return new Action(ActionType::FOLD,0);
 	}
 }
+
+bool
+AdaptivePlayer::equal (const Player& other){
+	if (this == &other) return true;
+
+	if (typeid(other) != typeid(AdaptivePlayer)) return false;
+
+	const AdaptivePlayer& o = static_cast<const AdaptivePlayer&>(other);
+	return o._prior == _prior
+		&& !memcmp(o._alpha, _alpha, sizeof(_alpha))
+		&& !memcmp(o._beta, _beta, sizeof(_beta))
+		&& !memcmp(o._shown, _shown, sizeof(_shown));
+}
+
+char*
+AdaptivePlayer::desc (char* buffer) const {
+	char* ptr = buffer;
+	for (int s=0; s<COMPILED_ROWS; s++)
+		ptr += sprintf(ptr,"%d %d %d\n",s,_range[0][s],_range[1][s]);
+
+	return buffer;
+}
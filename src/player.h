@@ -4,18 +4,26 @@
 
 #include "card.h"
 #include "action.h"
-#include "game.h"
+#include "gameview.h"
 #include "handutils.h"
+#include "strategy.h"
+#include "charts.h"
+#include "hash.h"
+#include "stats.h"
+#include "breakdown.h"
+#include "bootstrap.h"
 
 #include <ga/ga.h>
 
 #include "gnuplot-iostream.h"
 
 #include <iostream>
-
-class PokerGame;
-
-enum PlayerRole {SB,BB};
+#include <cmath>
+#include <random>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 
 #define MAX_PLAYER_DESC 1024
 #define TABLE_INFO_WEIGHT_CONSTANT 14112
@@ -68,6 +76,70 @@ private:
 
 #endif
 
+/**
+ *  @brief Control variates of the result of a hand: dealLuck(), known for
+ *  any pair of players, and DealValue::luck(), known when both strategies
+ *  are. Each one is regressed on its own.
+ */
+enum LuckKind {RANK_LUCK, STRATEGY_LUCK};
+
+/**
+ *  @brief Number of values of LuckKind.
+ */
+#define NLUCKS 2
+
+/**
+ *  @brief Snapshot of the performance counters of a player.
+ */
+struct PlayerStats {
+	long int acc;
+	unsigned long int nhands;
+	int outcome;
+	int nsb, nbb, nraised, ncalled;
+
+	/**
+	 *  @brief Chips credited in each hand.
+	 */
+	RunningStats results;
+
+	/**
+	 *  @brief Credited minus won chips, summed over every hand.
+	 */
+	double adjustment;
+
+	/**
+	 *  @brief Mean chips credited per hand in each match.
+	 */
+	RunningStats matches;
+
+	/**
+	 *  @brief Luck of the dealt hand and chips credited, for each LuckKind
+	 *  and role, at kind*NROLES + role.
+	 */
+	RunningCovariance deals[NLUCKS*NROLES];
+
+	/**
+	 *  @brief Results and decisions by role, stack and hand class, empty
+	 *  unless the player records them.
+	 */
+	EvBreakdown breakdown;
+
+	/**
+	 *  @brief Returns the counters gathered since an earlier snapshot.
+	 */
+	PlayerStats
+	since (const PlayerStats& before) const {
+		PlayerStats d = {acc - before.acc, nhands - before.nhands, outcome - before.outcome,
+				nsb - before.nsb, nbb - before.nbb, nraised - before.nraised,
+				ncalled - before.ncalled, results.since(before.results), adjustment - before.adjustment,
+				matches.since(before.matches)};
+		for (int r=0; r<NLUCKS*NROLES; r++)
+			d.deals[r] = deals[r].since(before.deals[r]);
+		d.breakdown = breakdown.since(before.breakdown);
+		return d;
+	}
+};
+
 /**
  *  @brief Base class for a player.
  */
@@ -161,15 +233,15 @@ public:
 
 	/**
 	 *  @brief Returns the action that the player should take when the state
-	 *  of the game is %game.
+	 *  of the game is %view.
 	 *
-	 *  @param game State of the game.
+	 *  @param view State of the game as seen by the player.
 	 *
 	 *  A pointer to an Action is returned. The caller of the method must take
 	 *  the responsibility of destroying the pointer.
 	 */
 	Action*
-	action(PokerGame* game);
+	action(const GameView& view);
 
 	/**
 	 *  @brief Player parametric description. All the parameters that define the
@@ -190,16 +262,66 @@ public:
 	virtual bool
 	equal (const Player& other) = 0;
 
+	/**
+	 *  @brief Returns a 64 bit hash of the player's type and parameters. Two
+	 *  players with the same hash play the same strategy.
+	 *
+	 *  By default only the type is hashed, which suits players without
+	 *  parameters.
+	 */
+	virtual unsigned long long
+	hash () const;
+
+	/**
+	 *  @brief Returns false if the results of the player's matches cannot be
+	 *  told from hash(), so a tournament must play each of them instead of
+	 *  reusing the result of an earlier one.
+	 */
+	virtual bool
+	cacheable () const { return true; }
+
+	/**
+	 *  @brief Event raised by tournaments before a match against an opponent
+	 *  starts. Players that learn from their opponent override it to forget
+	 *  the previous one.
+	 */
+	virtual void
+	matchStarted () {}
+
+	/**
+	 *  @brief Called by tournaments when a match is over, to count its
+	 *  results in matchEv(). Matches without hands are not counted.
+	 *
+	 *  @param start results() when the match started.
+	 */
+	void
+	matchFinished (const RunningStats& start) {
+		RunningStats r = _results.since(start);
+		if (r.count()) _matches.add(r.mean());
+	}
+
+	/**
+	 *  @brief Event raised by the engine when a heads-up hand is over. Players
+	 *  that learn from their opponent override it.
+	 *
+	 *  @param view Final state of the hand. %role is the role the player had
+	 *  and %effectiveStack the effective stack the hand was dealt with.
+	 *  @param shown Hole cards of the opponent if they were shown at
+	 *  showdown, NULL otherwise.
+	 */
+	virtual void
+	handFinished (const GameView& view, const Card* shown) {}
+
 protected:
 
 	/**
 	 *  @brief Computes the action that should be taken at the given state of
 	 *  the game.
 	 *
-	 *  @param state Game state.
+	 *  @param view Game state as seen by the player.
 	 */
 	virtual
-	Action* caction (PokerGame* game) = 0;
+	Action* caction (const GameView& view) = 0;
 
 	Card _hand[2];
 	long unsigned int _stack;
@@ -216,7 +338,37 @@ public:
 	 *  @param quantity The amount of chips won or lost.
 	 */
 	void
-	update_ev (int quantity);
+	update_ev (int quantity) { update_ev(quantity, quantity); }
+
+	/**
+	 *  @brief Updates the player with a profit or loss, crediting its score
+	 *  with a different amount.
+	 *
+	 *  @param quantity The amount of chips won or lost. Only the stack and
+	 *  realizedEv() follow it.
+	 *  @param credited The amount counted by ev() and results(), such as the
+	 *  expected result of an all-in.
+	 */
+	void
+	update_ev (int quantity, double credited);
+
+	/**
+	 *  @brief Same as update_ev(quantity, credited), also recording how lucky
+	 *  the deal was for controlledEv() and the hand in the breakdown.
+	 *
+	 *  @param role PlayerRole of the player in the hand.
+	 *  @param hand Numeric representation of the hand dealt to the player.
+	 *  @param stack Effective stack the hand was dealt with.
+	 *  @param luck Luck of the hand dealt to the player.
+	 *  @param kind LuckKind of %luck.
+	 */
+	void
+	update_ev (int quantity, double credited, int role, int hand, int stack, double luck,
+			int kind = RANK_LUCK) {
+		update_ev(quantity, credited);
+		_deals[kind*NROLES + role].add(luck, credited);
+		_breakdown.add(role, hand, stack, credited);
+	}
 
 	double
 	outcome () { return (_outcome/(double)_nhands); }
@@ -230,7 +382,71 @@ public:
 	 * It is used as an scoring system in a player based genetic algorithm.
 	 */
 	double
-	ev () { return (_acc/(double)_nhands)/2; }
+	ev () { return ((_acc + _adjustment)/_nhands)/2; }
+
+	/**
+	 *  @brief Returns the mean of ev() over the matches the player finished,
+	 *  each match weighing the same whatever its number of hands, or ev()
+	 *  if no match was counted.
+	 *
+	 *  Tournaments score players by it, since pooling hands would let the
+	 *  long matches between close players outweigh the short ones a
+	 *  sequential test stops early.
+	 */
+	double
+	matchEv () { return (_matches.count()) ? _matches.mean()/2 : ev(); }
+
+	/**
+	 *  @brief Returns the mean chips credited per hand in each match counted
+	 *  by matchEv().
+	 */
+	const RunningStats&
+	matchResults () const { return _matches; }
+
+	/**
+	 *  @brief Returns the chips actually won per hand, in big blinds. It
+	 *  differs from ev() when the games credit expected results.
+	 */
+	double
+	realizedEv () { return (_acc/(double)_nhands)/2; }
+
+	/**
+	 *  @brief Returns ev() corrected by the luck of the hands dealt to the
+	 *  player, using it as a control variate.
+	 *
+	 *  For each LuckKind and role, the chips credited are regressed on the
+	 *  luck, whose mean is known to be 0, and the mean is corrected by the
+	 *  luck observed. Only hands credited along with their luck count. It
+	 *  estimates the same as ev(), with less variance.
+	 */
+	double
+	controlledEv () const;
+
+	/**
+	 *  @brief Returns the standard error of controlledEv().
+	 */
+	double
+	controlledEvError () const;
+
+	/**
+	 *  @brief Returns the standard error of ev().
+	 */
+	double
+	evError () const { return _results.stderror()/2; }
+
+	/**
+	 *  @brief Returns the half width of a normal confidence interval of ev().
+	 *
+	 *  @param z Normal quantile of the confidence level.
+	 */
+	double
+	evHalfWidth (double z = STATS_Z95) const { return _results.halfWidth(z)/2; }
+
+	/**
+	 *  @brief Returns the mean and variance of the chips won or lost per hand.
+	 */
+	const RunningStats&
+	results () const { return _results; }
 
 	/**
 	 *  @brief Returns the number of hands played so far.
@@ -238,12 +454,81 @@ public:
 	unsigned long int
 	hands_played () { return _nhands; }
 
+	/**
+	 *  @brief Returns a snapshot of the performance counters.
+	 */
+	PlayerStats
+	stats () const {
+		PlayerStats s = {_acc, _nhands, _outcome, _nsb, _nbb, _nraised, _ncalled, _results, _adjustment,
+				_matches};
+		for (int r=0; r<NLUCKS*NROLES; r++)
+			s.deals[r] = _deals[r];
+		s.breakdown = _breakdown;
+		return s;
+	}
+
+	/**
+	 *  @brief Credits the player with counters gathered elsewhere, as if it had
+	 *  played those hands itself.
+	 */
+	void
+	credit (const PlayerStats& s) {
+		_acc += s.acc;
+		_nhands += s.nhands;
+		_outcome += s.outcome;
+		_nsb += s.nsb;
+		_nbb += s.nbb;
+		_nraised += s.nraised;
+		_ncalled += s.ncalled;
+		_results.merge(s.results);
+		_adjustment += s.adjustment;
+		_matches.merge(s.matches);
+		for (int r=0; r<NLUCKS*NROLES; r++)
+			_deals[r].merge(s.deals[r]);
+		_breakdown.merge(s.breakdown);
+	}
+
+	/**
+	 *  @brief Enables or disables recording results and decisions by role,
+	 *  effective stack and hand class. It is disabled by default.
+	 */
+	void
+	recordBreakdown (bool b) { (b) ? _breakdown.enable() : _breakdown.disable(); }
+
+	/**
+	 *  @brief Returns the results and decisions by role, effective stack and
+	 *  hand class. It is empty unless enabled with recordBreakdown().
+	 */
+	const EvBreakdown&
+	breakdown () const { return _breakdown; }
+
+	/**
+	 *  @brief Sets the bootstrap intervals of the player's score and rank in
+	 *  its last tournament.
+	 */
+	void
+	ranking (const RankingInterval& r) { _ranking = r; }
+
+	/**
+	 *  @brief Returns the bootstrap intervals of the player's score and rank
+	 *  in its last tournament. Their %replicates is 0 if they were not
+	 *  computed.
+	 */
+	const RankingInterval&
+	ranking () const { return _ranking; }
+
 	/**
 	 *  @brief Resets player's statistics. It is usually invoked before a tournament.
 	 */
 	virtual void
 	prepareForCompetition () {
-		_ev = 0;
+		_results = RunningStats();
+		_adjustment = 0;
+		_matches = RunningStats();
+		for (int r=0; r<NLUCKS*NROLES; r++)
+			_deals[r] = RunningCovariance();
+		_breakdown.clear();
+		_ranking.replicates = 0;
 		_nhands = 0;
 		_stack = 2000;
 		_acc = 0;
@@ -252,7 +537,12 @@ public:
 
 protected:
 
-	long double _ev;
+	RunningStats _results;
+	double _adjustment;
+	RunningStats _matches;
+	RunningCovariance _deals[NLUCKS*NROLES];
+	EvBreakdown _breakdown;
+	RankingInterval _ranking;
 	unsigned long int _nhands;
 
 public:
@@ -323,6 +613,55 @@ public:
 	float
 	called () { return (_nbb) ? (_ncalled/(float)_nbb) : -1;}
 
+	/**
+	 *  @brief Returns the decision a push/fold player takes: SB to choose
+	 *  whether to go all-in, BB to choose whether to call one.
+	 *
+	 *  Heads-up it is the role of the player. At bigger tables any seat but
+	 *  the big blind opens like the small blind while nobody has raised, and
+	 *  any seat facing a raise decides like the big blind.
+	 */
+	static PlayerRole
+	pushFoldRole (const GameView& view) {
+		if (view.role == PlayerRole::BB) return PlayerRole::BB;
+		for (int i=0; i<view.nactions; i++)
+			if (view.action(i) == ActionType::RAISE) return PlayerRole::BB;
+		return PlayerRole::SB;
+	}
+
+	/**
+	 *  @brief Counts a decision in the raise/call statistics. It is done by
+	 *  action(), engines that do not go through it call this instead.
+	 *
+	 *  @param role Decision taken, as given by pushFoldRole().
+	 *  @param aggressive Whether the player shoved as small blind or called
+	 *  as big blind.
+	 */
+	void
+	countDecision (int role, bool aggressive) {
+		if (role == PlayerRole::SB){
+			_nsb++;
+			if (aggressive) _nraised++;
+		}
+		else if (role == PlayerRole::BB){
+			_nbb++;
+			if (aggressive) _ncalled++;
+		}
+	}
+
+	/**
+	 *  @brief Same as countDecision(role, aggressive), also counting the
+	 *  decision in the breakdown.
+	 *
+	 *  @param hand Numeric representation of the player's hand.
+	 *  @param stack Effective stack of the hand.
+	 */
+	void
+	countDecision (int role, bool aggressive, int hand, int stack) {
+		countDecision(role, aggressive);
+		if (_breakdown.enabled()) _breakdown.decision(role, hand, stack, aggressive);
+	}
+
 private:
 	int _nbb,_nsb,_nraised,_ncalled;
 };
@@ -350,10 +689,10 @@ protected:
 	/**
 	 *  @brief The player goes all-in no matter the state of the game.
 	 *
-	 *  @param game Game state.
+	 *  @param view Game state.
 	 */
 	Action*
-	caction (PokerGame* game);
+	caction (const GameView& view);
 
 };
 
@@ -380,16 +719,17 @@ protected:
 	/**
 	 * @brief The player folds no matter the state of the game.
 	 *
-	 * @param game Game state.
+	 * @param view Game state.
 	 */
 	Action*
-	caction (PokerGame* game);
+	caction (const GameView& view);
 
 };
 
 /**
  *  @brief The chart that defines Nash player's strategy when it is in
- *  the small blind position.
+ *  the small blind position. It is indexed like handToNumeric: pairs on the
+ *  diagonal, suited hands above it and offsuit ones below.
  */
 const unsigned char sb_max_stack[NRANKS][NRANKS] = {
 	{20,20,20,20,20,20,20,20,20,20,20,20,20},
@@ -409,7 +749,8 @@ const unsigned char sb_max_stack[NRANKS][NRANKS] = {
 
 /**
  *  @brief The chart that defines Nash player's strategy when it is in
- *  the big blind position.
+ *  the big blind position. It is indexed like handToNumeric: pairs on the
+ *  diagonal, suited hands above it and offsuit ones below.
  */
 const unsigned char bb_max_stack[NRANKS][NRANKS] = {
 	{20,20,20,20,20,20,20,20,20,20,20,20,20},
@@ -451,11 +792,79 @@ protected:
 	 * @brief The player uses the nash equilibrium charts to make
 	 * a decision
 	 *
-	 * @param game Game state.
+	 * @param view Game state.
+	 */
+	Action*
+	caction (const GameView& view);
+
+};
+
+/**
+ *  @brief A player that uses the equilibrium chart of a blind structure,
+ *  taken from a ChartDatabase.
+ *
+ *  Unlike PlayerNash it knows stacks up to CHART_MAX_STACK and any blind
+ *  structure in the database. The database must outlive the player.
+ */
+class PlayerNashChart : public Player {
+public:
+	/**
+	 *  @brief Constructs the player with the chart of a blind structure. If
+	 *  the database has none, the player folds every hand.
+	 *
+	 *  @param db The database.
+	 *  @param sb Small blind.
+	 *  @param bb Big blind.
+	 *  @param ante Ante.
+	 */
+	PlayerNashChart (const ChartDatabase& db, int sb = 1, int bb = 2, int ante = 0);
+
+	/**
+	 *  @brief Clones the player.
+	 */
+	Player*
+	clonePlayer () const {
+		return new PlayerNashChart(*this);
+	}
+
+	/**
+	 *  @brief Returns false if the database had no chart for the structure.
+	 */
+	bool
+	valid () const { return _valid; }
+
+	/**
+	 *  @brief Returns the chart of the player.
+	 */
+	const PushFoldChart&
+	chart () const { return _chart; }
+
+	/**
+	 *  @brief Comparator. Players are equal if their charts are.
+	 */
+	bool
+	equal (const Player& other);
+
+	/**
+	 *  Inherited from Player. Hashes the type and the chart.
+	 */
+	unsigned long long
+	hash () const { return _hash; }
+
+protected:
+	/**
+	 *  @brief The player goes all-in or calls if the chart plays its hand at
+	 *  the effective stack.
+	 *
+	 *  @param view Game state.
 	 */
 	Action*
-	caction (PokerGame* game);
+	caction (const GameView& view);
 
+private:
+	PushFoldChart _chart;
+	bool _valid;
+	unsigned long long _hash;
 };
 
 /**
@@ -473,7 +882,11 @@ public:
 	 */
 	PlayerRaiseFoldPercent (double r, double c) :
 		_r(r),
-		_c(c) {}
+		_c(c)
+	{
+		_compiled.compileRange(PlayerRole::SB,r);
+		_compiled.compileRange(PlayerRole::BB,c);
+	}
 	/**
 	 *  @brief Player's parametric description. Raise and call probabilities are
 	 *  returned in the description.
@@ -504,6 +917,18 @@ public:
 	bool
 	equal (const Player& other);
 
+	/**
+	 *  Inherited from Player. Hashes the type and the raise and call ranges.
+	 */
+	unsigned long long
+	hash () const;
+
+	/**
+	 *  @brief Returns the strategy compiled from the raise and call ranges.
+	 */
+	const CompiledStrategy&
+	compiled () const { return _compiled; }
+
 protected:
 	/**
 	 *  @brief The player goes all-in if its hand is in the top r% of best hands.
@@ -513,10 +938,12 @@ protected:
 	 *  winning against a random hand.
 	 */
 	Action*
-	caction (PokerGame* game);
+	caction (const GameView& view);
 
 private:
 	double _r,_c;
+
+	CompiledStrategy _compiled;
 };
 
 
@@ -537,13 +964,29 @@ public:
 	init (GAGenome& g);
 
 	/**
-	 *  @brief Constructs the player and sets the initializer.
+	 *  @brief The default mutator of GA1DArrayGenome, followed by compile().
+	 */
+	static int
+	SwapMutator (GAGenome& c, float pmut);
+
+	/**
+	 *  @brief The default crossover of GA1DArrayGenome, followed by
+	 *  compile() on the children.
+	 */
+	static int
+	OnePointCrossover (const GAGenome& p1, const GAGenome& p2, GAGenome* c1, GAGenome* c2);
+
+	/**
+	 *  @brief Constructs the player and sets the initializer and operators.
 	 */
 	RCPlayer () :
 		Player (),
-		GA1DArrayGenome<float>(2)
+		GA1DArrayGenome<float>(2),
+		_hash(0)
 	{
 		initializer(init);
+		mutator(SwapMutator);
+		crossover(OnePointCrossover);
 	}
 
 	/**
@@ -555,8 +998,11 @@ public:
 		GA1DArrayGenome<float>(2)
 	{
 		initializer(init);
+		mutator(SwapMutator);
+		crossover(OnePointCrossover);
 		gene(0,raise);
 		gene(1,call);
+		compile();
 	}
 
 	/**
@@ -617,6 +1063,8 @@ public:
 		secondCard(p.secondCard());
 		//strcpy(_name,"Genetics copy");
 		_role = p.role();
+		_compiled = p._compiled;
+		_hash = p._hash;
 	}
 
 	/**
@@ -660,6 +1108,28 @@ public:
 			in.read((char*) &gene(i), sizeof(float));
 
 		Player::readResults(in);
+		compile();
+	}
+
+	/**
+	 *  Inherited from Player. Also compiles the current parameters, which the
+	 *  GA operators may have changed.
+	 */
+	void
+	prepareForCompetition () {
+		Player::prepareForCompetition();
+		compile();
+	}
+
+	/**
+	 *  @brief Rebuilds the compiled strategy and the hash from the raise and
+	 *  call parameters. It has to be called whenever they change.
+	 */
+	void
+	compile () {
+		_compiled.compileRange(PlayerRole::SB,r());
+		_compiled.compileRange(PlayerRole::BB,c());
+		_hash = hashValue(c(), hashValue(r(), hashValue(classID())));
 	}
 
 	/**
@@ -668,13 +1138,25 @@ public:
 	bool
 	equal (const Player& other);
 
+	/**
+	 *  Inherited from Player.
+	 */
+	unsigned long long
+	hash () const { return _hash; }
+
+	/**
+	 *  @brief Returns the strategy compiled from the current parameters.
+	 */
+	const CompiledStrategy&
+	compiled () const { return _compiled; }
+
 protected:
 	/**
 	 *  @brief The player goes all-in according to a fixed probability given by
 	 *  its internal raise/call parameters.
 	 */
 	Action*
-	caction (PokerGame* game);
+	caction (const GameView& view);
 
 private:
 
@@ -687,8 +1169,17 @@ private:
 	 */
 	float c () const { return gene(1); }
 
+	CompiledStrategy _compiled;
+	unsigned long long _hash;
 };
 
+/**
+ *  @brief Number of parameters of a RCTPlayer and number of 64 bit words that
+ *  hold them, one byte each.
+ */
+#define RCT_GENES (2*NHANDS)
+#define RCT_WORDS ((RCT_GENES + 7)/8)
+
 /**
  *  @brief Player which base the decision to go all-in or call on a raise/call
  *  parameter for each possible hand.
@@ -696,8 +1187,17 @@ private:
  *  When making a decision, the player compares the parameter associated with its current
  *  hand and if it is greater than the current effective stack of the game, then the player
  *  goes all-in.
+ *
+ *  Parameters range from 0 to 20, so the genome keeps one byte per parameter
+ *  packed in 64 bit words: the raise table followed by the call table, each in
+ *  the order of the numeric representation of the hands. Copies, crossovers
+ *  and comparisons work on whole words.
+ *
+ *  The strategy compiled from the tables is not part of the genome. It is
+ *  built the first time it is needed after the genes change, and copies
+ *  start without it.
  */
-class RCTPlayer : public GA3DArrayGenome<int>, public Player {
+class RCTPlayer : public GAGenome, public Player {
 public:
 	GADefineIdentity("PlayerRaiseFoldTableGenome",202);
 
@@ -735,6 +1235,20 @@ public:
 	static int
 	SubtleMutator (GAGenome& c, float pmut);
 
+	/**
+	 *  @brief Swaps parameters with others chosen at random, each one with
+	 *  probability pmut, as the swap mutator of GA3DArrayGenome. It is the
+	 *  default mutator.
+	 */
+	static int
+	SwapMutator (GAGenome& c, float pmut);
+
+	/**
+	 *  @brief Returns the portion of parameters that differ between two players.
+	 */
+	static float
+	HammingComparator (const GAGenome& a, const GAGenome& b);
+
 	/**
 	 *  @brief Constructs the player.
 	 */
@@ -750,14 +1264,15 @@ public:
 	 *  @brief Copy constructor.
 	 */
 	RCTPlayer (const RCTPlayer& orig) :
-		GA3DArrayGenome(NRANKS,NRANKS,2),
-		Player (){ copy(orig); }
+		GAGenome(init, SwapMutator, HammingComparator),
+		Player (),
+		_compiled(NULL) { copy(orig); }
 
 	/**
 	 *  @brief Destructor.
 	 */
 	virtual
-	~RCTPlayer () {}
+	~RCTPlayer () { delete _compiled.load(); }
 
 	/**
 	 *  @brief Assignment operator.
@@ -768,6 +1283,12 @@ public:
 		return *this;
 	}
 
+	RCTPlayer&
+	operator= (const RCTPlayer& orig) {
+		if (&orig != this) copy(orig);
+		return *this;
+	}
+
 	/**
 	 *  @brief Clones the player. Returns a pointer to a GAGenome
 	 */
@@ -793,15 +1314,29 @@ public:
 	virtual void
 	copy (const GAGenome& orig){
 		GAGenome::copy(orig);
-		GA3DArrayGenome<int>::copy(orig);
 		const RCTPlayer& p = DYN_CAST(const RCTPlayer&,orig);
+		memcpy(_words, p._words, sizeof(_words));
 		_bet = p.bet();
 		firstCard(p.firstCard());
 		secondCard(p.secondCard());
 		//strcpy(_name,"Genetics copy");
 		_role = p.role();
+		_hash = p._hash;
+		delete _compiled.exchange(NULL);
 	}
 
+	/**
+	 *  @brief Writes the tables as text. Inherited from GAGenome.
+	 */
+	int
+	write (std::ostream& out) const;
+
+	/**
+	 *  @brief Reads the tables as text. Inherited from GAGenome.
+	 */
+	int
+	read (std::istream& in);
+
 	/**
 	 *  @brief Player's parametric description.
 	 */
@@ -812,14 +1347,18 @@ public:
 	 *  output stream.
 	 *
 	 *  @param out The stream to write the contents to.
+	 *
+	 *  Parameters are written as ints, as they were stored before the genome
+	 *  was packed, so older files can still be read.
 	 */
 	void
 	writeResults (std::ostream& out) const{
-		//GA3DArrayGenome<int>::write(out);
 		for (int i=0; i<width(); i++)
 			for (int j=0; j<height(); j++)
-				for (int k=0; k<depth(); k++)
-					out.write((const char*) &gene(i,j,k), sizeof(int));
+				for (int k=0; k<depth(); k++){
+					int g = gene(i,j,k);
+					out.write((const char*) &g, sizeof(int));
+				}
 
 		Player::writeResults(out);
 	}
@@ -834,43 +1373,815 @@ public:
 	readResults (std::istream& in){
 		for (int i=0; i<width(); i++)
 			for (int j=0; j<height(); j++)
-				for (int k=0; k<depth(); k++)
-					in.read((char*) &gene(i,j,k), sizeof(int));
+				for (int k=0; k<depth(); k++){
+					int g = 0;
+					in.read((char*) &g, sizeof(int));
+					gene(i,j,k,g);
+				}
 
 		Player::readResults(in);
+		compile();
 	}
 
 	/**
-	 *  @brief Comparator.
+	 *  Inherited from Player. Also compiles the current parameters, in case
+	 *  they were changed without going through the operators of this class.
+	 */
+	void
+	prepareForCompetition () {
+		Player::prepareForCompetition();
+		compile();
+		compiled();
+	}
+
+	/**
+	 *  @brief Rebuilds the hash from the raise and call tables and drops the
+	 *  compiled strategy, which is built again when needed. It has to be
+	 *  called whenever the genes change.
+	 */
+	void
+	compile ();
+
+	/**
+	 *  @brief Comparator. Players are equal if their tables are.
 	 */
 	bool
 	equal (const Player& other);
 
 	/**
-	 *  @brief Returns the raise parameter associated with the encoded
-	 *  hand (i,j).
+	 *  @brief Comparator used by GAlib. Returns 1 if the tables are equal.
 	 */
 	int
-	raiseTable(int i, int j) const
-		{ return gene(i,j,0); }
+	equal (const GAGenome& other) const;
 
 	/**
-	 *  @brief Returns the call parameter associated with the encoded
+	 *  Inherited from Player.
+	 */
+	unsigned long long
+	hash () const { return _hash; }
+
+	/**
+	 *  @brief Returns the parameter of the encoded hand (i,j) in the raise
+	 *  (k=0) or call (k=1) table.
+	 */
+	int
+	gene (int i, int j, int k) const { return genes()[k*NHANDS + i*NRANKS + j]; }
+
+	/**
+	 *  @brief Sets a parameter. It is clamped between 0 and 20.
+	 */
+	void
+	gene (int i, int j, int k, int value) {
+		genes()[k*NHANDS + i*NRANKS + j] = std::min(std::max(value,0),20); }
+
+	/**
+	 *  @brief Dimensions of the tables, as in a GA3DArrayGenome.
+	 */
+	int width () const { return NRANKS; }
+	int height () const { return NRANKS; }
+	int depth () const { return 2; }
+
+	/**
+	 *  @brief Returns the raise parameter associated with the encoded
+	 *  hand (i,j).
+	 */
+	int
+	raiseTable(int i, int j) const
+		{ return gene(i,j,0); }
+
+	/**
+	 *  @brief Returns the call parameter associated with the encoded
 	 *  hand (i,j).
 	 */
 	int
 	callTable(int i, int j) const
 		{ return gene(i,j,1); }
 
+	/**
+	 *  @brief Returns the strategy compiled from the current tables. It is
+	 *  built on the first call after the genes change. Several threads may
+	 *  call it at once, but not while the genes are being changed.
+	 */
+	const CompiledStrategy&
+	compiled () const;
+
 protected:
 	/**
 	 *  @brief The player goes all-in if the parameter associated with its current
 	 *  hand is less than the current effective stack.
 	 *
-	 *  @param game Game state.
+	 *  @param view Game state.
 	 */
 	Action*
-	caction (PokerGame* game);
+	caction (const GameView& view);
+
+private:
+	unsigned char*
+	genes () { return reinterpret_cast<unsigned char*>(_words); }
+
+	const unsigned char*
+	genes () const { return reinterpret_cast<const unsigned char*>(_words); }
+
+	/**
+	 *  @brief The parameters. Bytes past RCT_GENES are always zero.
+	 */
+	unsigned long long _words[RCT_WORDS];
+	unsigned long long _hash;
+
+	/**
+	 *  @brief Strategy compiled from the tables, NULL until needed.
+	 */
+	mutable std::atomic<CompiledStrategy*> _compiled;
+};
+
+/**
+ *  @brief Player following a fixed push/fold chart: for each hand, the biggest
+ *  effective stack at which it shoves as small blind and calls as big blind.
+ *
+ *  It is the frozen form of a table strategy, e.g. a RCTPlayer picked from an
+ *  evolution and stored in a strategy library.
+ */
+class PlayerChart : public Player {
+public:
+	/**
+	 *  @brief Constructs a player that always folds.
+	 */
+	PlayerChart ();
+
+	/**
+	 *  @brief Constructs the player from two charts indexed by the numeric
+	 *  representation of the hands.
+	 *
+	 *  @param sb Biggest stack at which each hand goes all-in.
+	 *  @param bb Biggest stack at which each hand calls.
+	 */
+	PlayerChart (const unsigned char* sb, const unsigned char* bb);
+
+	/**
+	 *  @brief Constructs the player with the current tables of a RCTPlayer.
+	 */
+	PlayerChart (const RCTPlayer& p);
+
+	/**
+	 *  @brief Clones the player.
+	 */
+	Player*
+	clonePlayer () const {
+		return new PlayerChart(*this);
+	}
+
+	/**
+	 *  @brief Comparator.
+	 */
+	bool
+	equal (const Player& other);
+
+	/**
+	 *  Inherited from Player. Hashes the type and the charts.
+	 */
+	unsigned long long
+	hash () const { return _hash; }
+
+	/**
+	 *  @brief Player's parametric description. The small blind chart is
+	 *  returned in the description, in the layout of RCTPlayer::desc.
+	 */
+	char*
+	desc (char* buffer) const;
+
+	/**
+	 *  @brief Writes the charts along with the player's performance to an
+	 *  output stream.
+	 */
+	void
+	writeResults (std::ostream& out) const {
+		out.write((const char*) _chart, sizeof(_chart));
+		Player::writeResults(out);
+	}
+
+	/**
+	 *  @brief Reads the charts along with the player's performance from an
+	 *  input stream.
+	 */
+	void
+	readResults (std::istream& in) {
+		in.read((char*) _chart, sizeof(_chart));
+		Player::readResults(in);
+		compile();
+	}
+
+	/**
+	 *  @brief Returns the biggest stack at which a hand is played.
+	 *
+	 *  @param role SB for the shoving chart, BB for the calling one.
+	 *  @param hand Numeric representation of the hand.
+	 */
+	int
+	chart (int role, int hand) const { return _chart[role != PlayerRole::SB][hand]; }
+
+	/**
+	 *  @brief Returns the strategy compiled from the charts.
+	 */
+	const CompiledStrategy&
+	compiled () const { return _compiled; }
+
+protected:
+	/**
+	 *  @brief The player goes all-in or calls if the effective stack is not
+	 *  bigger than the chart entry of its hand.
+	 *
+	 *  @param view Game state.
+	 */
+	Action*
+	caction (const GameView& view);
+
+private:
+	void
+	compile ();
+
+	unsigned char _chart[2][NHANDS];
+	CompiledStrategy _compiled;
+	unsigned long long _hash;
+};
+
+/**
+ *  @brief Smallest and biggest effective stacks with their own parameters in
+ *  a MixedPlayer. Other stacks use the closest one.
+ */
+#define MIXED_MIN_STACK 3
+#define MIXED_MAX_STACK 20
+#define MIXED_NSTACKS (MIXED_MAX_STACK - MIXED_MIN_STACK + 1)
+
+/**
+ *  @brief Player which shoves or calls with a certain probability for each
+ *  possible hand and effective stack. It has evolution capabilities.
+ *
+ *  The genome is a NRANKS x NRANKS x 2*MIXED_NSTACKS table of probabilities.
+ *  The first MIXED_NSTACKS layers hold the shoving probabilities and the rest
+ *  the calling ones. Decisions are sampled from a random generator owned by
+ *  the calling thread.
+ */
+class MixedPlayer : public GA3DArrayGenome<float>, public Player {
+public:
+	GADefineIdentity("MixedPlayerGenome",206);
+
+	/**
+	 *  @brief Initializes the probabilities randomly between 0 and 1.
+	 */
+	static void
+	init (GAGenome& g);
+
+	/**
+	 *  @brief Initializes the player as a pure strategy that plays the first
+	 *  <random number> strongest hands at every stack.
+	 */
+	static void
+	raiseCallInitializer (GAGenome& g);
+
+	/**
+	 *  @brief Performs a crossover between two players. Each hand swaps all its
+	 *  probabilities, for every stack, with a certain probability.
+	 */
+	static int
+	mergeCrossover (const GAGenome& p1, const GAGenome& p2, GAGenome* c1, GAGenome* c2);
+
+	/**
+	 *  @brief Adds a small gaussian noise to each probability with a given
+	 *  probability pmut.
+	 */
+	static int
+	GaussianMutator (GAGenome& c, float pmut);
+
+	/**
+	 *  @brief Constructs the player.
+	 */
+	MixedPlayer ();
+
+	/**
+	 *  @brief Constructs a pure player that always shoves the first raise% strongest
+	 *  hands and calls with the first call% strongest hands.
+	 */
+	MixedPlayer (float raise, float call);
+
+	/**
+	 *  @brief Copy constructor.
+	 */
+	MixedPlayer (const MixedPlayer& orig) :
+		GA3DArrayGenome(NRANKS,NRANKS,2*MIXED_NSTACKS),
+		Player (){ copy(orig); }
+
+	/**
+	 *  @brief Destructor.
+	 */
+	virtual
+	~MixedPlayer () {}
+
+	/**
+	 *  @brief Assignment operator.
+	 */
+	MixedPlayer&
+	operator= (const GAGenome& orig) {
+		if (&orig != this) copy(orig);
+		return *this;
+	}
+
+	/**
+	 *  @brief Clones the player. Returns a pointer to a GAGenome
+	 */
+	virtual GAGenome*
+	clone (GAGenome::CloneMethod flags=CONTENTS) const {
+		return new MixedPlayer(*this);
+	}
+
+	/**
+	 *  @brief Clones the player. Returns a pointer to a Player.
+	 */
+	Player* clonePlayer () const {
+		return new MixedPlayer(*this);
+	}
+
+	/**
+	 *  @brief Copies the contents of another GAGenome.
+	 *
+	 *  @param orig The GAGenome to be copied.
+	 *
+	 *  This method assumes that the GAGenome copied is of type MixedPlayer.
+	 */
+	virtual void
+	copy (const GAGenome& orig){
+		GAGenome::copy(orig);
+		GA3DArrayGenome<float>::copy(orig);
+		const MixedPlayer& p = DYN_CAST(const MixedPlayer&,orig);
+		_bet = p.bet();
+		firstCard(p.firstCard());
+		secondCard(p.secondCard());
+		_role = p.role();
+		_hash = p._hash;
+	}
+
+	/**
+	 *  @brief Player's parametric description. The shoving probability of each
+	 *  hand, averaged over every stack.
+	 */
+	char*
+	desc (char* buffer) const;
+
+	/**
+	 *  @brief Writes the player's performance along with its parameters to an
+	 *  output stream.
+	 *
+	 *  @param out The stream to write the contents to.
+	 */
+	void
+	writeResults (std::ostream& out) const{
+		for (int i=0; i<width(); i++)
+			for (int j=0; j<height(); j++)
+				for (int k=0; k<depth(); k++)
+					out.write((const char*) &gene(i,j,k), sizeof(float));
+
+		Player::writeResults(out);
+	}
+
+	/**
+	 *  @brief Reads a player's performance along with its parameters from an
+	 *  input stream.
+	 *
+	 *  @param in The stream to read the contents from.
+	 */
+	void
+	readResults (std::istream& in){
+		for (int i=0; i<width(); i++)
+			for (int j=0; j<height(); j++)
+				for (int k=0; k<depth(); k++)
+					in.read((char*) &gene(i,j,k), sizeof(float));
+
+		Player::readResults(in);
+		rehash();
+	}
+
+	/**
+	 *  Inherited from Player. Also rehashes the genome, in case it was changed
+	 *  without going through the operators of this class.
+	 */
+	void
+	prepareForCompetition () {
+		Player::prepareForCompetition();
+		rehash();
+	}
+
+	/**
+	 *  @brief Comparator. Players are equal if their probabilities are.
+	 */
+	bool
+	equal (const Player& other);
+
+	/**
+	 *  Inherited from Player.
+	 */
+	unsigned long long
+	hash () const { return _hash; }
+
+	/**
+	 *  @brief Recomputes the hash of the probabilities. It has to be called
+	 *  whenever the genes change.
+	 */
+	void
+	rehash ();
+
+	/**
+	 *  @brief Returns the probability of shoving a hand as small blind.
+	 *
+	 *  @param stack Effective stack.
+	 *  @param hand Numeric representation of the hand.
+	 */
+	float
+	shoveProbability (int stack, int hand) const
+		{ return gene(hand/NRANKS,hand%NRANKS,layer(stack)); }
+
+	/**
+	 *  @brief Returns the probability of calling a shove as big blind.
+	 *
+	 *  @param stack Effective stack.
+	 *  @param hand Numeric representation of the hand.
+	 */
+	float
+	callProbability (int stack, int hand) const
+		{ return gene(hand/NRANKS,hand%NRANKS,MIXED_NSTACKS + layer(stack)); }
+
+	/**
+	 *  @brief Returns true with probability %p, drawn from the generator of
+	 *  the calling thread.
+	 */
+	static bool
+	draw (float p);
+
+protected:
+	/**
+	 *  @brief The player samples its decision from the probability associated
+	 *  with its hand and the effective stack.
+	 *
+	 *  @param view Game state.
+	 */
+	Action*
+	caction (const GameView& view);
+
+private:
+	static int
+	layer (int stack) {
+		return std::min(std::max(stack,MIXED_MIN_STACK),MIXED_MAX_STACK) - MIXED_MIN_STACK; }
+
+	unsigned long long _hash;
+};
+
+/**
+ *  @brief Number of genes of a PostflopPlayer: the two preflop ranges plus a
+ *  betting threshold and a calling margin for each street after the flop.
+ */
+#define POSTFLOP_GENES 8
+
+/**
+ *  @brief Player that plays every street, betting and calling according to
+ *  the equity of its hand on the current board. It has evolution
+ *  capabilities.
+ *
+ *  Preflop it raises to three times the bet with the strongest %raise portion
+ *  of the hands, calls with the strongest %play portion and only calls raises
+ *  with hands in its raising range. On later streets it bets the pot when its
+ *  equity reaches the threshold of the street and calls when the equity beats
+ *  the pot odds plus the margin of the street. Equities are read from
+ *  boardEquity, so evaluating a situation is paid once by the whole
+ *  tournament.
+ */
+class PostflopPlayer : public GA1DArrayGenome<float>, public Player {
+public:
+	GADefineIdentity("PostflopPlayerGenome",207);
+
+	/**
+	 *  @brief Initializes every parameter randomly between 0 and 1.
+	 */
+	static void
+	init (GAGenome& g);
+
+	/**
+	 *  @brief Adds a small gaussian noise to each parameter with a given
+	 *  probability pmut.
+	 */
+	static int
+	GaussianMutator (GAGenome& c, float pmut);
+
+	/**
+	 *  @brief The default crossover of GA1DArrayGenome, followed by
+	 *  rehash() on the children.
+	 */
+	static int
+	OnePointCrossover (const GAGenome& p1, const GAGenome& p2, GAGenome* c1, GAGenome* c2);
+
+	/**
+	 *  @brief Constructs the player.
+	 */
+	PostflopPlayer ();
+
+	/**
+	 *  @brief Constructs a player with the same threshold and margin on every
+	 *  street.
+	 *
+	 *  @param play Portion of the hands played preflop.
+	 *  @param raise Portion of the hands raised preflop.
+	 *  @param bet Equity needed to bet after the flop.
+	 *  @param margin Calling margin after the flop. 0.5 calls exactly at the
+	 *  pot odds, higher values need more equity.
+	 */
+	PostflopPlayer (float play, float raise, float bet, float margin);
+
+	/**
+	 *  @brief Copy constructor.
+	 */
+	PostflopPlayer (const PostflopPlayer& orig) :
+		GA1DArrayGenome<float>(POSTFLOP_GENES),
+		Player (){ copy(orig); }
+
+	/**
+	 *  @brief Destructor.
+	 */
+	virtual
+	~PostflopPlayer () {}
+
+	/**
+	 *  @brief Assignment operator.
+	 */
+	PostflopPlayer&
+	operator= (const GAGenome& orig) {
+		if (&orig != this) copy(orig);
+		return *this;
+	}
+
+	/**
+	 *  @brief Clones the player. Returns a pointer to a GAGenome
+	 */
+	virtual GAGenome*
+	clone (GAGenome::CloneMethod flags=CONTENTS) const {
+		return new PostflopPlayer(*this);
+	}
+
+	/**
+	 *  @brief Clones the player. Returns a pointer to a Player.
+	 */
+	Player* clonePlayer () const {
+		return new PostflopPlayer(*this);
+	}
+
+	/**
+	 *  @brief Copies the contents of another GAGenome.
+	 *
+	 *  @param orig The GAGenome to be copied.
+	 *
+	 *  This method assumes that the GAGenome copied is of type PostflopPlayer.
+	 */
+	virtual void
+	copy (const GAGenome& orig){
+		GAGenome::copy(orig);
+		GA1DArrayGenome<float>::copy(orig);
+		const PostflopPlayer& p = DYN_CAST(const PostflopPlayer&,orig);
+		_bet = p.bet();
+		firstCard(p.firstCard());
+		secondCard(p.secondCard());
+		_role = p.role();
+		_hash = p._hash;
+	}
+
+	/**
+	 *  @brief Player's parametric description.
+	 */
+	char*
+	desc (char* buffer) const;
+
+	/**
+	 *  @brief Writes the player's performance along with its parameters to an
+	 *  output stream.
+	 *
+	 *  @param out The stream to write the contents to.
+	 */
+	void
+	writeResults (std::ostream& out) const{
+		for (int i=0; i<length(); i++)
+			out.write((const char*) &gene(i), sizeof(float));
+
+		Player::writeResults(out);
+	}
+
+	/**
+	 *  @brief Reads a player's performance along with its parameters from an
+	 *  input stream.
+	 *
+	 *  @param in The stream to read the contents from.
+	 */
+	void
+	readResults (std::istream& in){
+		for (int i=0; i<length(); i++)
+			in.read((char*) &gene(i), sizeof(float));
+
+		Player::readResults(in);
+		rehash();
+	}
+
+	/**
+	 *  Inherited from Player. Also rehashes the genome, in case it was changed
+	 *  without going through the operators of this class.
+	 */
+	void
+	prepareForCompetition () {
+		Player::prepareForCompetition();
+		rehash();
+	}
+
+	/**
+	 *  @brief Comparator. Players are equal if their parameters are.
+	 */
+	bool
+	equal (const Player& other);
+
+	/**
+	 *  Inherited from Player.
+	 */
+	unsigned long long
+	hash () const { return _hash; }
+
+	/**
+	 *  @brief Recomputes the hash of the parameters. It has to be called
+	 *  whenever the genes change.
+	 */
+	void
+	rehash ();
+
+protected:
+	/**
+	 *  @brief The player compares the equity of its hand with the thresholds
+	 *  of the current street.
+	 *
+	 *  @param view Game state.
+	 */
+	Action*
+	caction (const GameView& view);
+
+private:
+	Action*
+	preflop (const GameView& view, int toCall);
+
+	unsigned long long _hash;
+};
+
+/**
+ *  @brief Pseudo counts of the prior of an AdaptivePlayer. Until it sees that
+ *  many decisions at a stack, it expects the opponent to play about half of
+ *  its hands there.
+ */
+#define ADAPTIVE_PRIOR 2
+
+/**
+ *  @brief Push/fold player that models its opponent and plays the best
+ *  response to that model.
+ *
+ *  For every row of a CompiledStrategy it keeps a Beta posterior of how often
+ *  the opponent shoves as small blind and calls as big blind. The range
+ *  assumed for the opponent is made of the strongest classes of the hand
+ *  ranking that cover the posterior mean, and is never narrower than the
+ *  weakest hand shown at showdown at that stack.
+ *
+ *  Decisions are cached. When the range of a stack changes only the cached
+ *  decisions against it are dropped, and each one is worked out again in
+ *  constant time the next time it is needed.
+ *
+ *  The model is updated as it plays, so the same player must not play several
+ *  matches at the same time. It is forgotten at the start of every match, and
+ *  by prepareForCompetition.
+ */
+class AdaptivePlayer : public Player {
+public:
+	/**
+	 *  @brief Constructs the player.
+	 *
+	 *  @param prior Weight of the prior, in number of decisions.
+	 */
+	AdaptivePlayer (float prior = ADAPTIVE_PRIOR);
+
+	/**
+	 *  @brief Clones the player, along with what it knows about its opponent.
+	 */
+	Player*
+	clonePlayer () const {
+		return new AdaptivePlayer(*this);
+	}
+
+	/**
+	 *  @brief Comparator. Players are equal if their priors and their models
+	 *  of the opponent are.
+	 */
+	bool
+	equal (const Player& other);
+
+	/**
+	 *  Inherited from Player. Hashes the type and the prior, which is the
+	 *  model every match starts from.
+	 */
+	unsigned long long
+	hash () const { return hashValue(_prior, Player::hash()); }
+
+	/**
+	 *  Inherited from Player. Results depend on the opponents met during the
+	 *  match, so they are never reused.
+	 */
+	bool
+	cacheable () const { return false; }
+
+	/**
+	 *  Inherited from Player. Forgets the model of the opponent.
+	 */
+	void
+	matchStarted () { forget(); }
+
+	/**
+	 *  @brief Player's parametric description. One line per stack with the
+	 *  number of classes assumed in the opponent's shoving and calling ranges.
+	 */
+	char*
+	desc (char* buffer) const;
+
+	/**
+	 *  Inherited from Player. Also forgets the model of the opponent.
+	 */
+	void
+	prepareForCompetition () {
+		Player::prepareForCompetition();
+		forget();
+	}
+
+	/**
+	 *  @brief Goes back to the prior.
+	 */
+	void
+	forget ();
+
+	/**
+	 *  Event. Inherited from Player. Updates the model with the opponent's
+	 *  decision and its hand, if shown.
+	 */
+	void
+	handFinished (const GameView& view, const Card* shown);
+
+	/**
+	 *  @brief Returns the number of classes of the hand ranking that the
+	 *  opponent is assumed to play.
+	 *
+	 *  @param role Role of the opponent, SB for its shoving range and BB for
+	 *  its calling range.
+	 *  @param stack Effective stack.
+	 */
+	int
+	range (int role, int stack) const {
+		return _range[role != PlayerRole::SB][CompiledStrategy::row(stack)]; }
+
+protected:
+	/**
+	 *  @brief The player shoves or calls if it is the best response to the
+	 *  range assumed for the opponent. Any bet that is not all-in, and every
+	 *  decision after the flop, is called.
+	 *
+	 *  @param view Game state.
+	 */
+	Action*
+	caction (const GameView& view);
+
+private:
+	void
+	observe (int role, int stack, bool aggressive);
+
+	void
+	observeHand (int role, int stack, int hand);
+
+	void
+	estimate (int role, int stack);
+
+	bool
+	play (int role, int stack, int hand);
+
+	bool
+	bestResponse (int role, int stack, int hand) const;
+
+	float _prior;
+
+	/**
+	 *  Model of the opponent, indexed by its role (0 for SB, 1 for BB) and the
+	 *  row of the stack: parameters of the Beta posterior, position in the
+	 *  ranking of the weakest hand shown and number of classes assumed.
+	 */
+	float _alpha[2][COMPILED_ROWS], _beta[2][COMPILED_ROWS];
+	int _shown[2][COMPILED_ROWS];
+	int _range[2][COMPILED_ROWS];
+
+	/**
+	 *  Decisions taken so far, and which of them are still valid.
+	 */
+	CompiledStrategy _decided, _valid;
 };
 
 #endif
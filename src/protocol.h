@@ -0,0 +1,123 @@
+#ifndef _PROTOCOL_H_
+#define _PROTOCOL_H_
+
+#include <cstddef>
+
+#include "gameview.h"
+
+/**
+ *  @file Binary protocol spoken with bots running in another process.
+ *
+ *  The engine writes to the standard input of the bot and reads from its
+ *  standard output. Both ends must be built from this header on the same
+ *  machine, since records are sent as they are laid out in memory.
+ *
+ *  The engine starts by sending a ProtocolHello, which the bot answers with
+ *  the same record. Then the engine sends batches: a BatchHeader followed by
+ *  %count DecisionRequest records. The bot answers every batch with a
+ *  BatchHeader and one DecisionResponse per request, in any order.
+ */
+
+#define PROTOCOL_MAGIC 0x5042484e
+#define PROTOCOL_VERSION 2
+
+/**
+ *  @brief Maximum number of requests in a batch.
+ */
+#define PROTOCOL_MAX_BATCH 1024
+
+/**
+ *  @brief First record sent by each end.
+ */
+struct ProtocolHello {
+	unsigned int magic;
+	unsigned int version;
+} __attribute__((packed));
+
+/**
+ *  @brief Precedes the records of a batch.
+ */
+struct BatchHeader {
+	unsigned int count;
+} __attribute__((packed));
+
+/**
+ *  @brief The fields of a GameView, as they go over the wire. It has no
+ *  padding, so no uninitialized bytes are sent.
+ */
+struct WireView {
+	unsigned long long board;
+	unsigned long long history;
+	short effectiveStack;
+	short pot;
+	short roundBet;
+	unsigned char role;
+	unsigned char street;
+	unsigned char nactions;
+	unsigned char nplaying;
+} __attribute__((packed));
+
+static_assert(sizeof(WireView) == 26, "WireView must not have padding");
+
+// A field added to GameView changes its size or moves nplaying: add it to
+// WireView and wireView() too, then bump PROTOCOL_VERSION.
+static_assert(sizeof(GameView) == 32 && offsetof(GameView, nplaying) == 25,
+		"GameView changed, update WireView and wireView()");
+
+/**
+ *  @brief Copies a view into its wire record.
+ */
+inline WireView
+wireView (const GameView& view){
+	WireView w;
+	w.board = view.board;
+	w.history = view.history;
+	w.effectiveStack = view.effectiveStack;
+	w.pot = view.pot;
+	w.roundBet = view.roundBet;
+	w.role = view.role;
+	w.street = view.street;
+	w.nactions = view.nactions;
+	w.nplaying = view.nplaying;
+	return w;
+}
+
+/**
+ *  @brief A decision the bot has to take.
+ */
+struct DecisionRequest {
+	/**
+	 *  @brief Identifier of the request within its batch, echoed in the
+	 *  response.
+	 */
+	unsigned int id;
+
+	/**
+	 *  @brief State of the hand as seen by the bot.
+	 */
+	WireView view;
+
+	/**
+	 *  @brief Identifiers of the bot's hole cards.
+	 */
+	unsigned char hand[2];
+} __attribute__((packed));
+
+/**
+ *  @brief The bot's answer to a DecisionRequest.
+ */
+struct DecisionResponse {
+	unsigned int id;
+
+	/**
+	 *  @brief An ActionType.
+	 */
+	unsigned char action;
+
+	/**
+	 *  @brief Amount to raise to, for raises.
+	 */
+	short to;
+} __attribute__((packed));
+
+#endif
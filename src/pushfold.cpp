@@ -0,0 +1,105 @@
+#include "pushfold.h"
+#include "game.h"
+
+#include <typeinfo>
+
+void
+pushFoldShowdown (Card hands[2][2], Card* board, Card* dead, unsigned short* shares){
+	char str_hands[10];
+	char* str_com = str_cards(board, 5);
+	char* str_dead = str_cards(dead, 3);
+	char* hand0 = str_cards(hands[0], 2);
+	char* hand1 = str_cards(hands[1], 2);
+	Results* res = alloc_results();
+
+	strncpy(str_hands, hand0, 4);
+	str_hands[4] = ':';
+	strncpy(&str_hands[5], hand1, 4);
+	str_hands[9] = '\0';
+
+	calc(str_hands, str_com, str_dead, MC_ITER, res);
+
+	shares[0] = (unsigned short) lround(res->ev[0] * SHARE_SCALE);
+	shares[1] = (unsigned short) lround(res->ev[1] * SHARE_SCALE);
+
+	free_results(res);
+	delete [] hand0;
+	delete [] hand1;
+	delete [] str_com;
+	delete [] str_dead;
+}
+
+const CompiledStrategy*
+compiledStrategy (const Player& p){
+	const std::type_info& type = typeid(p);
+	if (type == typeid(RCTPlayer))
+		return &static_cast<const RCTPlayer&>(p).compiled();
+	if (type == typeid(RCPlayer))
+		return &static_cast<const RCPlayer&>(p).compiled();
+	if (type == typeid(PlayerRaiseFoldPercent))
+		return &static_cast<const PlayerRaiseFoldPercent&>(p).compiled();
+	if (type == typeid(PlayerChart))
+		return &static_cast<const PlayerChart&>(p).compiled();
+
+	return NULL;
+}
+
+/**
+ *  Settings of a match, passed along while the policies are resolved.
+ */
+struct MatchSetup {
+	int n;
+	bool randomEffectiveStack;
+	const SequentialTest* test;
+	bool allInAdjusted;
+	GameObserver* observer;
+	const DealProposal* proposal;
+};
+
+template <class P1, class P2>
+static void
+playMatch (Player& p1, const P1& policy1, Player& p2, const P2& policy2, const MatchSetup& setup){
+	PushFoldMatch<P1,P2> m(p1, policy1, p2, policy2);
+	m.randomEffectiveStack(setup.randomEffectiveStack);
+	m.allInAdjusted(setup.allInAdjusted);
+	m.importanceSampling(setup.proposal);
+	if (setup.observer) m.attachObserver(setup.observer);
+	m.playSeveralHands(setup.n, setup.test);
+}
+
+template <class P1>
+static bool
+playAgainst (Player& p1, const P1& policy1, Player& p2, const MatchSetup& setup){
+	const CompiledStrategy* s = compiledStrategy(p2);
+	if (s)
+		playMatch(p1, policy1, p2, CompiledPolicy(*s), setup);
+	else if (typeid(p2) == typeid(PlayerNash))
+		playMatch(p1, policy1, p2, NashPolicy(), setup);
+	else if (typeid(p2) == typeid(PlayerNashChart))
+		playMatch(p1, policy1, p2, ChartPolicy(static_cast<const PlayerNashChart&>(p2).chart()), setup);
+	else if (typeid(p2) == typeid(MixedPlayer))
+		playMatch(p1, policy1, p2, MixedPolicy(static_cast<const MixedPlayer&>(p2)), setup);
+	else
+		return false;
+
+	return true;
+}
+
+bool
+playPushFoldMatch (Player& p1, Player& p2, int n, bool randomEffectiveStack,
+		const SequentialTest* test, bool allInAdjusted, GameObserver* observer,
+		const DealProposal* proposal){
+	MatchSetup setup = {n, randomEffectiveStack, test, allInAdjusted, observer, proposal};
+
+	const CompiledStrategy* s = compiledStrategy(p1);
+	if (s)
+		return playAgainst(p1, CompiledPolicy(*s), p2, setup);
+	else if (typeid(p1) == typeid(PlayerNash))
+		return playAgainst(p1, NashPolicy(), p2, setup);
+	else if (typeid(p1) == typeid(PlayerNashChart))
+		return playAgainst(p1, ChartPolicy(static_cast<const PlayerNashChart&>(p1).chart()), p2, setup);
+	else if (typeid(p1) == typeid(MixedPlayer))
+		return playAgainst(p1, MixedPolicy(static_cast<const MixedPlayer&>(p1)), p2, setup);
+
+	return false;
+}
@@ -0,0 +1,393 @@
+#ifndef _PUSHFOLD_H_
+#define _PUSHFOLD_H_
+
+#include <random>
+#include <vector>
+
+#include "player.h"
+#include "deck.h"
+#include "history.h"
+#include "equity.h"
+#include "sampling.h"
+
+/**
+ *  @brief Push/fold policy backed by a CompiledStrategy. It stands for
+ *  RCTPlayer, RCPlayer, PlayerRaiseFoldPercent and PlayerChart.
+ */
+struct CompiledPolicy {
+	CompiledPolicy (const CompiledStrategy& s) : strategy(&s) {}
+
+	bool
+	shove (int stack, const Card* hand) const {
+		return strategy->aggressive(PlayerRole::SB, stack, handToNumeric(hand[0],hand[1])); }
+
+	bool
+	call (int stack, const Card* hand) const {
+		return strategy->aggressive(PlayerRole::BB, stack, handToNumeric(hand[0],hand[1])); }
+
+	const CompiledStrategy* strategy;
+};
+
+/**
+ *  @brief Push/fold policy of PlayerNash.
+ */
+struct NashPolicy {
+	bool
+	shove (int stack, const Card* hand) const {
+		int h = handToNumeric(hand[0],hand[1]);
+		return stack <= sb_max_stack[h/NRANKS][h%NRANKS]; }
+
+	bool
+	call (int stack, const Card* hand) const {
+		int h = handToNumeric(hand[0],hand[1]);
+		return stack <= bb_max_stack[h/NRANKS][h%NRANKS]; }
+};
+
+/**
+ *  @brief Push/fold policy backed by a PushFoldChart. It stands for
+ *  PlayerNashChart.
+ */
+struct ChartPolicy {
+	ChartPolicy (const PushFoldChart& c) : chart(c) {}
+
+	bool
+	shove (int stack, const Card* hand) const {
+		return chart.aggressive(PlayerRole::SB, stack, handToNumeric(hand[0],hand[1])); }
+
+	bool
+	call (int stack, const Card* hand) const {
+		return chart.aggressive(PlayerRole::BB, stack, handToNumeric(hand[0],hand[1])); }
+
+	PushFoldChart chart;
+};
+
+/**
+ *  @brief Push/fold policy of a MixedPlayer. Decisions are sampled.
+ */
+struct MixedPolicy {
+	MixedPolicy (const MixedPlayer& p) : player(&p) {}
+
+	bool
+	shove (int stack, const Card* hand) const {
+		return MixedPlayer::draw(player->shoveProbability(stack, handToNumeric(hand[0],hand[1]))); }
+
+	bool
+	call (int stack, const Card* hand) const {
+		return MixedPlayer::draw(player->callProbability(stack, handToNumeric(hand[0],hand[1]))); }
+
+	const MixedPlayer* player;
+};
+
+/**
+ *  @brief Returns the compiled strategy of a player, or NULL if its type
+ *  has none.
+ */
+const CompiledStrategy*
+compiledStrategy (const Player& p);
+
+/**
+ *  @brief Evaluates a showdown between two hands. Shares are written in
+ *  seat order, out of SHARE_SCALE.
+ */
+void
+pushFoldShowdown (Card hands[2][2], Card* board, Card* dead, unsigned short* shares);
+
+/**
+ *  @brief Heads-up push/fold engine for two known strategy types.
+ *
+ *  A policy is any type with two const methods, shove(stack, hand) and
+ *  call(stack, hand), returning true when the hand must go all-in as small
+ *  blind or call the shove as big blind. Decisions are resolved at compile
+ *  time, so a match pays no virtual call, allocation or type check per hand.
+ *
+ *  It deals and scores hands exactly as a heads-up PokerGame does when
+ *  both players only push or fold, and updates the same statistics of the
+ *  players. Observers receive the same HandRecord the PokerGame would give
+ *  them. The board is only dealt for hands that end with a fold when there
+ *  are observers, so that their records can be replayed.
+ *
+ *  When both players have a compiled strategy, their luck is the DealValue
+ *  of their hands, and dealLuck otherwise.
+ */
+template <class P1, class P2>
+class PushFoldMatch {
+public:
+	/**
+	 *  @brief Creates the match.
+	 *
+	 *  @param player1 The first seat, which starts with the button.
+	 *  @param policy1 The strategy of %player1.
+	 *  @param player2 The second seat.
+	 *  @param policy2 The strategy of %player2.
+	 */
+	PushFoldMatch (Player& player1, const P1& policy1, Player& player2, const P2& policy2) :
+		_policy1(policy1),
+		_policy2(policy2),
+		_startingStack(1000),
+		_randomEffectiveStack(false),
+		_allInAdjusted(false),
+		_proposal(NULL)
+	{
+		_players[0] = &player1;
+		_players[1] = &player2;
+
+		const CompiledStrategy* s1 = compiledStrategy(player1);
+		const CompiledStrategy* s2 = compiledStrategy(player2);
+		_values[0] = (s1 && s2) ? new DealValue(*s1, *s2) : NULL;
+		_values[1] = (s1 && s2) ? new DealValue(*s2, *s1) : NULL;
+	}
+
+	/**
+	 *  @brief Destroys the match.
+	 */
+	~PushFoldMatch () {
+		delete _values[0];
+		delete _values[1];
+	}
+
+	/**
+	 *  @brief Plays hands until one of the players cannot afford the blinds,
+	 *  %n hands have been played or %test is met. Same as
+	 *  PokerGame::playSeveralHands.
+	 *
+	 *  @return Number of hands played.
+	 */
+	int
+	playSeveralHands (int n, const SequentialTest* test = NULL){
+		std::default_random_engine generator;
+		std::uniform_int_distribution<int> uniform(DEAL_MIN_STACK,DEAL_MAX_STACK);
+
+		_players[0]->stack(_startingStack);
+		_players[1]->stack(_startingStack);
+
+		RunningStats start = _players[0]->results();
+		int dealer = 0, i = 0;
+		while (i < n){
+			i++;
+			int effectiveStack = 20;
+			double weight = 1;
+			if (_randomEffectiveStack && _proposal) weight = _proposal->drawStack(&effectiveStack);
+			else if (_randomEffectiveStack) effectiveStack = uniform(generator);
+
+			if (dealer == 0) play(_policy1, _policy2, 0, effectiveStack, weight);
+			else play(_policy2, _policy1, 1, effectiveStack, weight);
+
+			if (_players[0]->stack() < 3 || _players[1]->stack() < 3)
+				break;
+			if (test && test->resolved(_players[0]->results().since(start)))
+				break;
+
+			dealer ^= 1;
+		}
+
+		return i;
+	}
+
+	/**
+	 *  @brief Sets the stack of each player at the beginning of the match.
+	 */
+	void
+	startingStack (int stack) { _startingStack = stack; }
+
+	/**
+	 *  @brief Enables choosing the effective stack randomly in each hand.
+	 */
+	void
+	randomEffectiveStack (bool b) { _randomEffectiveStack = b; }
+
+	/**
+	 *  @brief Enables crediting players with the expected result of each
+	 *  all-in, as PokerGame::allInAdjusted. The expectation is the equity of
+	 *  the hand classes, given by classEquity.
+	 */
+	void
+	allInAdjusted (bool b) { _allInAdjusted = b; }
+
+	/**
+	 *  @brief Deals the hand of the first player from a proposal, as
+	 *  PokerGame::importanceSampling.
+	 */
+	void
+	importanceSampling (const DealProposal* proposal) { _proposal = proposal; }
+
+	/**
+	 *  @brief Attaches an observer, notified after every hand.
+	 */
+	void
+	attachObserver (GameObserver* observer) { _observers.push_back(observer); }
+
+private:
+	template <class SB, class BB>
+	void
+	play (const SB& sb, const BB& bb, int dealer, int effectiveStack, double weight){
+		Player* psb = _players[dealer];
+		Player* pbb = _players[dealer ^ 1];
+
+		int stack = std::min<int>(effectiveStack, std::min(psb->stack(), pbb->stack()));
+
+		// Hands are kept in seat order. The small blind is dealt first.
+		Card hands[2][2];
+		Card* hsb = hands[dealer];
+		Card* hbb = hands[dealer ^ 1];
+
+		_deck.shuffle();
+		if (_proposal){
+			weight *= _proposal->drawHand(hands[0]);
+			_deck.remove(hands[0][0].id());
+			_deck.remove(hands[0][1].id());
+			hands[1][0] = _deck.popCard(); hands[1][1] = _deck.popCard();
+		}
+		else {
+			hsb[0] = _deck.popCard(); hsb[1] = _deck.popCard();
+			hbb[0] = _deck.popCard(); hbb[1] = _deck.popCard();
+		}
+
+		int result[2];
+		bool expected = false;
+		double credited[2];
+		int& rsb = result[dealer];
+		int& rbb = result[dealer ^ 1];
+
+		int classes[2] = {handToNumeric(hands[0][0],hands[0][1]),
+				handToNumeric(hands[1][0],hands[1][1])};
+		int csb = classes[dealer];
+		int cbb = classes[dealer ^ 1];
+
+		GameView actions;
+		actions.clear();
+		unsigned short shares[2] = {0, 0};
+		Card board[5], dead[3];
+		bool dealt = false;
+
+		bool shoved = sb.shove(stack, hsb);
+		psb->countDecision(PlayerRole::SB, shoved, csb, stack);
+		actions.push((shoved) ? ActionType::RAISE : ActionType::FOLD);
+		if (!shoved){
+			rsb = -1;
+			rbb = 1;
+		}
+		else if (!bb.call(stack, hbb)){
+			pbb->countDecision(PlayerRole::BB, false, cbb, stack);
+			actions.push(ActionType::FOLD);
+			rsb = 2;
+			rbb = -2;
+		}
+		else {
+			pbb->countDecision(PlayerRole::BB, true, cbb, stack);
+			actions.push(ActionType::CALL);
+
+			deal(board, dead);
+			dealt = true;
+			pushFoldShowdown(hands, board, dead, shares);
+
+			int pot = 2*stack;
+			result[0] = pot*shares[0]/SHARE_SCALE;
+			result[1] = pot*shares[1]/SHARE_SCALE;
+			// Odd chips go to the first player after the button among
+			// those with the largest share.
+			((shares[dealer] > shares[dealer ^ 1]) ? rsb : rbb) += pot - result[0] - result[1];
+
+			result[0] -= stack;
+			result[1] -= stack;
+
+			if (_allInAdjusted){
+				float e = classEquity(classes[0], classes[1]);
+				credited[0] = pot*e - stack;
+				credited[1] = pot*(1 - e) - stack;
+				expected = true;
+			}
+		}
+
+		for (int s=0; s<2; s++){
+			int role = (s == dealer) ? PlayerRole::SB : PlayerRole::BB;
+			double c = weight*((expected) ? credited[s] : result[s]);
+			if (_values[dealer])
+				_players[s]->update_ev(result[s], c, role, classes[s], stack,
+						weight*_values[dealer]->luck(role, classes[s], stack), STRATEGY_LUCK);
+			else
+				_players[s]->update_ev(result[s], c, role, classes[s], stack,
+						weight*dealLuck(classes[s], stack));
+		}
+
+		if (_observers.empty()) return;
+		if (!dealt) deal(board, dead);
+
+		HandRecord record;
+		record.history = actions.history;
+		record.nactions = actions.nactions;
+		record.nseats = 2;
+		record.dealer = dealer;
+		record.effectiveStack = stack;
+		record.showdown = (dealt) ? 3 : 0;
+		for (int s=0; s<2; s++){
+			record.result[s] = result[s];
+			record.share[s] = shares[s];
+			record.hole[s][0] = hands[s][0].id();
+			record.hole[s][1] = hands[s][1].id();
+		}
+		for (int i=0; i<5; i++)
+			record.board[i] = board[i].id();
+
+		for (std::vector<GameObserver*>::iterator it = _observers.begin(); it != _observers.end(); it++)
+			(*it)->handPlayed(record);
+	}
+
+	/**
+	 *  Deals the board and the burnt cards in the order PokerGame does.
+	 */
+	void
+	deal (Card* board, Card* dead){
+		dead[0] = _deck.popCard();
+		board[0] = _deck.popCard();
+		board[1] = _deck.popCard();
+		board[2] = _deck.popCard();
+		dead[1] = _deck.popCard();
+		board[3] = _deck.popCard();
+		dead[2] = _deck.popCard();
+		board[4] = _deck.popCard();
+	}
+
+	PushFoldMatch (const PushFoldMatch&);
+	PushFoldMatch& operator= (const PushFoldMatch&);
+
+	Player* _players[2];
+	P1 _policy1;
+	P2 _policy2;
+	Deck _deck;
+
+	int _startingStack;
+	bool _randomEffectiveStack;
+	bool _allInAdjusted;
+	const DealProposal* _proposal;
+	std::vector<GameObserver*> _observers;
+
+	/**
+	 *  Values of the deals when each seat is the small blind, NULL unless
+	 *  both strategies are compiled.
+	 */
+	const DealValue* _values[2];
+};
+
+/**
+ *  @brief Plays a heads-up match with a PushFoldMatch if both players have a
+ *  known push/fold policy.
+ *
+ *  @param p1 The first seat.
+ *  @param p2 The second seat.
+ *  @param n Maximum number of hands.
+ *  @param randomEffectiveStack Whether the effective stack is drawn in each
+ *  hand.
+ *  @param test If given, the match stops as soon as the rule is met.
+ *  @param allInAdjusted Whether players are credited with the expected
+ *  result of each all-in.
+ *  @param observer If given, it is notified of every hand.
+ *  @param proposal If given, the hand of %p1 and the effective stack are
+ *  dealt from it, as PushFoldMatch::importanceSampling.
+ *  @return false if any of the players has no policy. Nothing is played then.
+ */
+bool
+playPushFoldMatch (Player& p1, Player& p2, int n, bool randomEffectiveStack=false,
+		const SequentialTest* test=NULL, bool allInAdjusted=false, GameObserver* observer=NULL,
+		const DealProposal* proposal=NULL);
+
+#endif
@@ -0,0 +1,86 @@
+#include "sampling.h"
+#include "equity.h"
+
+#include <random>
+#include <algorithm>
+
+/**
+ *  Returns a number uniformly distributed in [0,1), drawn from the
+ *  generator of the calling thread.
+ */
+static double
+uniform (){
+	thread_local std::mt19937 generator(std::random_device{}());
+	return std::uniform_real_distribution<double>(0,1)(generator);
+}
+
+DealProposal::DealProposal (){
+	std::fill(_hand, _hand + NHANDS, 1.0);
+	std::fill(_stack, _stack + DEAL_NSTACKS, 1.0);
+	update();
+}
+
+void
+DealProposal::handWeight (int hand, double w){
+	_hand[hand] = w;
+	update();
+}
+
+void
+DealProposal::stackWeight (int stack, double w){
+	if (stack < DEAL_MIN_STACK || stack > DEAL_MAX_STACK) return;
+	_stack[stack - DEAL_MIN_STACK] = w;
+	update();
+}
+
+DealProposal
+DealProposal::rareClasses (double factor){
+	DealProposal p;
+	for (int r=0; r<NRANKS; r++){
+		p._hand[r*NRANKS + r] = factor;
+		// Ace is rank 0, suited hands have the lower rank first.
+		if (r) p._hand[r] = factor;
+	}
+	p.update();
+	return p;
+}
+
+void
+DealProposal::update (){
+	_handTotal = 0;
+	for (int h=0; h<NHANDS; h++){
+		_handTotal += handCombos(h)*_hand[h];
+		_handCdf[h] = _handTotal;
+	}
+
+	_stackTotal = 0;
+	for (int s=0; s<DEAL_NSTACKS; s++){
+		_stackTotal += _stack[s];
+		_stackCdf[s] = _stackTotal;
+	}
+}
+
+double
+DealProposal::drawHand (Card* hand) const {
+	int h = std::upper_bound(_handCdf, _handCdf + NHANDS, uniform()*_handTotal) - _handCdf;
+	h = std::min(h, NHANDS - 1);
+
+	int i = h/NRANKS, j = h%NRANKS;
+	// Suited hands share the suit. Pairs and offsuit hands take any other.
+	int s1 = std::min((int) (uniform()*4), 3);
+	int s2 = (i < j) ? s1 : (s1 + 1 + std::min((int) (uniform()*3), 2)) % 4;
+
+	hand[0] = Card(s1*CARDS_PER_SUIT + i);
+	hand[1] = Card(s2*CARDS_PER_SUIT + j);
+
+	return _handTotal/(NCOMBOS*_hand[h]);
+}
+
+double
+DealProposal::drawStack (int* stack) const {
+	int s = std::upper_bound(_stackCdf, _stackCdf + DEAL_NSTACKS, uniform()*_stackTotal) - _stackCdf;
+	s = std::min(s, DEAL_NSTACKS - 1);
+
+	*stack = DEAL_MIN_STACK + s;
+	return _stackTotal/(DEAL_NSTACKS*_stack[s]);
+}
@@ -0,0 +1,92 @@
+#ifndef _SAMPLING_H_
+#define _SAMPLING_H_
+
+#include "handutils.h"
+#include "card.h"
+
+/**
+ *  @brief Effective stacks drawn by the engines when the effective stack is
+ *  random.
+ */
+#define DEAL_MIN_STACK 3
+#define DEAL_MAX_STACK 20
+#define DEAL_NSTACKS (DEAL_MAX_STACK - DEAL_MIN_STACK + 1)
+
+/**
+ *  @brief Distribution from which the hand of the first seat and the
+ *  effective stack are dealt in importance sampling.
+ *
+ *  Each hand class and each stack has a weight, 1 by default. A class is
+ *  dealt with a probability proportional to its weight times its number of
+ *  combinations, and a stack with a probability proportional to its weight.
+ *  With every weight equal to 1 the deals are the same as usual.
+ *
+ *  Results of a hand dealt this way must be multiplied by the ratio returned
+ *  by draw() to stay unbiased: oversampled cells are seen more often but
+ *  count less each time.
+ */
+class DealProposal {
+public:
+	/**
+	 *  @brief Constructs the uniform proposal.
+	 */
+	DealProposal ();
+
+	/**
+	 *  @brief Sets the weight of a hand class.
+	 *
+	 *  @param hand Numeric representation of the hand.
+	 *  @param w Weight, greater than 0.
+	 */
+	void
+	handWeight (int hand, double w);
+
+	/**
+	 *  @brief Sets the weight of an effective stack between DEAL_MIN_STACK
+	 *  and DEAL_MAX_STACK.
+	 */
+	void
+	stackWeight (int stack, double w);
+
+	/**
+	 *  @brief Returns a proposal that deals pairs and suited aces %factor
+	 *  times more often than the rest of the classes.
+	 */
+	static DealProposal
+	rareClasses (double factor);
+
+	/**
+	 *  @brief Draws the hand of the first seat.
+	 *
+	 *  @param hand Array where the two cards are stored.
+	 *  @return Probability of the class when dealing at random divided by its
+	 *  probability under the proposal.
+	 */
+	double
+	drawHand (Card* hand) const;
+
+	/**
+	 *  @brief Draws an effective stack.
+	 *
+	 *  @param stack Where the stack is stored.
+	 *  @return Probability of the stack when drawn uniformly divided by its
+	 *  probability under the proposal.
+	 */
+	double
+	drawStack (int* stack) const;
+
+private:
+	void
+	update ();
+
+	double _hand[NHANDS], _stack[DEAL_NSTACKS];
+
+	/**
+	 *  Cumulative probabilities of the proposal and normalizing constants,
+	 *  kept up to date by update().
+	 */
+	double _handCdf[NHANDS], _stackCdf[DEAL_NSTACKS];
+	double _handTotal, _stackTotal;
+};
+
+#endif
@@ -0,0 +1,279 @@
+#include "server.h"
+#include "pushfold.h"
+#include "io.h"
+
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+StrategyTable::StrategyTable (const StrategyLibrary& library){
+	for (int i=0; i<library.size(); i++){
+		Player* p = library.load(i);
+		if (!p || add(*p) < 0){
+			_strategies.push_back(CompiledStrategy());
+			_hashes.push_back(0);
+		}
+		delete p;
+	}
+}
+
+int
+StrategyTable::add (const Player& p){
+	const CompiledStrategy* s = compiledStrategy(p);
+	if (!s) return -1;
+
+	_strategies.push_back(*s);
+	// Zero marks empty positions.
+	_hashes.push_back((p.hash()) ? p.hash() : 1);
+	return _strategies.size() - 1;
+}
+
+/**
+ *  @brief Fills a socket address. Returns false if the path is too long.
+ */
+static bool
+socketAddress (const char* path, struct sockaddr_un* addr){
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr->sun_path)) return false;
+	strcpy(addr->sun_path, path);
+	return true;
+}
+
+DecisionServer::DecisionServer (const char* path) :
+	_path(path),
+	_listen(-1),
+	_table(new StrategyTable()),
+	_stop(false),
+	_queries(0)
+{
+	_tables.push_back(const_cast<StrategyTable*>(_table.load()));
+
+	bindSocket();
+}
+
+DecisionServer::~DecisionServer (){
+	stop();
+	if (_listen >= 0){
+		close(_listen);
+		unlink(_path.c_str());
+	}
+
+	for (std::vector<StrategyTable*>::iterator it = _tables.begin(); it != _tables.end(); it++)
+		delete *it;
+}
+
+bool
+DecisionServer::bindSocket (){
+	struct sockaddr_un addr;
+	if (!socketAddress(_path.c_str(), &addr)) return false;
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) return false;
+
+	unlink(_path.c_str());
+	if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) || listen(fd, SOMAXCONN)){
+		close(fd);
+		return false;
+	}
+	_listen = fd;
+	return true;
+}
+
+void
+DecisionServer::publish (StrategyTable* table){
+	std::lock_guard<std::mutex> guard(_lock);
+	_tables.push_back(table);
+	_table.store(table, std::memory_order_release);
+}
+
+void
+DecisionServer::start (){
+	if (_acceptor.joinable() || (_listen < 0 && !bindSocket())) return;
+
+	_stop = false;
+	_acceptor = std::thread(&DecisionServer::acceptLoop, this);
+}
+
+void
+DecisionServer::stop (){
+	if (!_acceptor.joinable()) return;
+
+	_stop = true;
+	// Wakes up the thread blocked in accept. A socket shut down this way
+	// cannot listen again, so start() binds a new one.
+	shutdown(_listen, SHUT_RDWR);
+	_acceptor.join();
+	close(_listen);
+	unlink(_path.c_str());
+	_listen = -1;
+
+	// Wakes up the threads blocked in read, and waits for them to be over.
+	std::unique_lock<std::mutex> lock(_lock);
+	for (std::vector<int>::iterator it = _clients.begin(); it != _clients.end(); it++)
+		shutdown(*it, SHUT_RDWR);
+	while (!_clients.empty())
+		_idle.wait(lock);
+}
+
+void
+DecisionServer::acceptLoop (){
+	while (!_stop){
+		int fd = accept4(_listen, NULL, NULL, SOCK_CLOEXEC);
+		if (fd < 0){
+			if (errno == EINTR || errno == ECONNABORTED) continue;
+			break;
+		}
+
+		std::lock_guard<std::mutex> guard(_lock);
+		if (_stop){
+			close(fd);
+			break;
+		}
+		// Threads are not kept: each one leaves _clients when it is over,
+		// which is what stop() waits for.
+		_clients.push_back(fd);
+		std::thread(&DecisionServer::serve, this, fd).detach();
+	}
+}
+
+void
+DecisionServer::serve (int fd){
+	std::vector<StrategyQuery> queries(SERVER_MAX_BATCH);
+	std::vector<char> answers(sizeof(QueryHeader) + SERVER_MAX_BATCH);
+
+	QueryHeader header;
+	while (readAll(fd, (char*) &header, sizeof(QueryHeader))){
+		if (header.count > SERVER_MAX_BATCH) break;
+		if (header.count && !readAll(fd, (char*) &queries[0], header.count*sizeof(StrategyQuery)))
+			break;
+
+		// The same table answers the whole batch.
+		const StrategyTable* table = _table.load(std::memory_order_acquire);
+		memcpy(&answers[0], &header, sizeof(QueryHeader));
+		unsigned char* a = (unsigned char*) &answers[sizeof(QueryHeader)];
+		for (unsigned int i=0; i<header.count; i++)
+			a[i] = table->answer(queries[i]);
+
+		if (!writeAll(fd, &answers[0], sizeof(QueryHeader) + header.count)) break;
+		_queries.fetch_add(header.count, std::memory_order_relaxed);
+	}
+
+	// The server may be destroyed as soon as the lock is released, so
+	// nothing of it is touched afterwards.
+	std::lock_guard<std::mutex> guard(_lock);
+	_clients.erase(std::find(_clients.begin(), _clients.end(), fd));
+	close(fd);
+	_idle.notify_all();
+}
+
+DecisionClient::DecisionClient (const char* path) :
+	_fd(-1)
+{
+	struct sockaddr_un addr;
+	if (!socketAddress(path, &addr)) return;
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) return;
+
+	if (connect(fd, (struct sockaddr*) &addr, sizeof(addr))){
+		close(fd);
+		return;
+	}
+	_fd = fd;
+	_buffer.resize(sizeof(QueryHeader) + SERVER_MAX_BATCH*sizeof(StrategyQuery));
+}
+
+DecisionClient::~DecisionClient (){
+	if (_fd >= 0) close(_fd);
+}
+
+bool
+DecisionClient::query (const StrategyQuery* queries, int n, unsigned char* answers){
+	if (_fd < 0 || n < 0 || n > SERVER_MAX_BATCH) return false;
+
+	QueryHeader header = {(unsigned int) n};
+	memcpy(&_buffer[0], &header, sizeof(QueryHeader));
+	memcpy(&_buffer[sizeof(QueryHeader)], queries, n*sizeof(StrategyQuery));
+
+	bool ok = writeAll(_fd, &_buffer[0], sizeof(QueryHeader) + n*sizeof(StrategyQuery))
+		&& readAll(_fd, (char*) &header, sizeof(QueryHeader))
+		&& header.count == (unsigned int) n
+		&& readAll(_fd, (char*) answers, n);
+
+	if (!ok){
+		close(_fd);
+		_fd = -1;
+	}
+	return ok;
+}
+
+static void
+loadClient (const char* path, int batches, int batch, int strategies, int seed,
+		std::vector<double>* latencies, unsigned long int* queries){
+	DecisionClient client(path);
+	std::mt19937 gen(seed);
+	std::uniform_int_distribution<int> strategy(0, std::max(strategies - 1, 0));
+	std::uniform_int_distribution<int> hand(0, NHANDS - 1);
+	std::uniform_int_distribution<int> stack(3, COMPILED_MAX_STACK);
+
+	std::vector<StrategyQuery> q(batch);
+	std::vector<unsigned char> answers(batch);
+	latencies->reserve(batches);
+	*queries = 0;
+
+	for (int b=0; b<batches && client.valid(); b++){
+		for (int i=0; i<batch; i++){
+			q[i].strategy = strategy(gen);
+			q[i].hand = hand(gen);
+			q[i].role = (gen() & 1) ? PlayerRole::SB : PlayerRole::BB;
+			q[i].stack = stack(gen);
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (!client.query(&q[0], batch, &answers[0])) break;
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		latencies->push_back(std::chrono::duration<double,std::micro>(end - start).count());
+		*queries += batch;
+	}
+}
+
+LoadReport
+generateLoad (const char* path, int clients, int batches, int batch, int strategies){
+	batch = std::min(std::max(batch, 1), SERVER_MAX_BATCH);
+
+	std::vector<std::vector<double> > latencies(clients);
+	std::vector<unsigned long int> queries(clients);
+	std::vector<std::thread> threads;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int c=0; c<clients; c++)
+		threads.push_back(std::thread(loadClient, path, batches, batch, strategies, c + 1,
+				&latencies[c], &queries[c]));
+	for (std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); it++)
+		it->join();
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+	std::vector<double> all;
+	LoadReport report;
+	report.queries = 0;
+	for (int c=0; c<clients; c++){
+		all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+		report.queries += queries[c];
+	}
+	std::sort(all.begin(), all.end());
+
+	report.seconds = std::chrono::duration<double>(end - start).count();
+	report.throughput = (report.seconds > 0) ? report.queries/report.seconds : 0;
+	report.p50 = (all.empty()) ? 0 : all[all.size()/2];
+	report.p99 = (all.empty()) ? 0 : all[std::min(all.size() - 1, all.size()*99/100)];
+	report.max = (all.empty()) ? 0 : all.back();
+
+	return report;
+}
@@ -0,0 +1,281 @@
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "strategy.h"
+#include "library.h"
+
+/**
+ *  @file Decision server for compiled strategies.
+ *
+ *  Clients connect to a Unix socket and send batches: a QueryHeader followed
+ *  by %count StrategyQuery records. The server answers every batch with a
+ *  QueryHeader and one byte per query, in the same order: 1 if the hand is
+ *  played, 0 if it is folded and SERVER_UNKNOWN if the query names a
+ *  strategy or hand that does not exist. Records are sent as they are laid
+ *  out in memory.
+ */
+
+/**
+ *  @brief Maximum number of queries in a batch.
+ */
+#define SERVER_MAX_BATCH 4096
+
+/**
+ *  @brief Answer to a query that cannot be resolved.
+ */
+#define SERVER_UNKNOWN 0xff
+
+/**
+ *  @brief Precedes the records of a batch, both ways.
+ */
+struct QueryHeader {
+	unsigned int count;
+} __attribute__((packed));
+
+/**
+ *  @brief Asks whether a strategy plays a hand.
+ */
+struct StrategyQuery {
+	/**
+	 *  @brief Position of the strategy in the StrategyTable.
+	 */
+	unsigned int strategy;
+
+	/**
+	 *  @brief Numeric representation of the hand.
+	 */
+	unsigned char hand;
+
+	/**
+	 *  @brief SB to ask whether it goes all-in, BB whether it calls.
+	 */
+	unsigned char role;
+
+	/**
+	 *  @brief Effective stack.
+	 */
+	unsigned short stack;
+} __attribute__((packed));
+
+/**
+ *  @brief Immutable set of compiled strategies served by a DecisionServer.
+ */
+class StrategyTable {
+public:
+	/**
+	 *  @brief Creates an empty table.
+	 */
+	StrategyTable () {}
+
+	/**
+	 *  @brief Loads every strategy of a library. Strategies keep their
+	 *  position in the library. Those without a compiled form, such as
+	 *  MixedPlayer, answer SERVER_UNKNOWN.
+	 */
+	StrategyTable (const StrategyLibrary& library);
+
+	/**
+	 *  @brief Appends the strategy of a player.
+	 *
+	 *  @return Its position, or -1 if the player has no compiled strategy.
+	 *  Nothing is appended then.
+	 */
+	int
+	add (const Player& p);
+
+	/**
+	 *  @brief Returns the number of strategies.
+	 */
+	int
+	size () const { return _strategies.size(); }
+
+	/**
+	 *  @brief Returns the Player::hash() of a strategy, 0 if the position is
+	 *  empty.
+	 */
+	unsigned long long
+	hash (int i) const { return _hashes[i]; }
+
+	/**
+	 *  @brief Answers a query.
+	 */
+	unsigned char
+	answer (const StrategyQuery& q) const {
+		if (q.strategy >= _strategies.size() || !_hashes[q.strategy] || q.hand >= NHANDS)
+			return SERVER_UNKNOWN;
+		return _strategies[q.strategy].aggressive(q.role, q.stack, q.hand);
+	}
+
+private:
+	std::vector<CompiledStrategy> _strategies;
+	std::vector<unsigned long long> _hashes;
+};
+
+/**
+ *  @brief Serves a StrategyTable over a Unix socket.
+ *
+ *  Each connection is served by its own thread, which ends with it. Queries
+ *  read the current table through an atomic pointer and take no lock, so a
+ *  new table can be published while queries are being answered. Tables
+ *  that are replaced are kept until the server is destroyed, since a query
+ *  may still be reading them.
+ */
+class DecisionServer {
+public:
+	/**
+	 *  @brief Binds the socket. Any file at %path is replaced.
+	 *
+	 *  @param path Path of the socket.
+	 */
+	DecisionServer (const char* path);
+
+	/**
+	 *  @brief Stops the server and removes the socket.
+	 */
+	~DecisionServer ();
+
+	/**
+	 *  @brief Returns false if the socket is not bound: it could not be, or
+	 *  the server was stopped.
+	 */
+	bool
+	valid () const { return _listen >= 0; }
+
+	/**
+	 *  @brief Makes a table the one answered from now on. The server takes
+	 *  the responsibility of destroying it.
+	 */
+	void
+	publish (StrategyTable* table);
+
+	/**
+	 *  @brief Starts accepting connections in a background thread. The
+	 *  socket is bound again if the server was stopped.
+	 */
+	void
+	start ();
+
+	/**
+	 *  @brief Closes every connection, waits for their threads to be over,
+	 *  and closes the socket.
+	 */
+	void
+	stop ();
+
+	/**
+	 *  @brief Returns the number of queries answered so far.
+	 */
+	unsigned long int
+	queries () const { return _queries.load(std::memory_order_relaxed); }
+
+private:
+	DecisionServer (const DecisionServer&);
+	DecisionServer& operator= (const DecisionServer&);
+
+	bool
+	bindSocket ();
+
+	void
+	acceptLoop ();
+
+	void
+	serve (int fd);
+
+	std::string _path;
+	int _listen;
+
+	std::atomic<const StrategyTable*> _table;
+	std::atomic<bool> _stop;
+	std::atomic<unsigned long int> _queries;
+
+	/**
+	 *  Tables published and connections open, guarded by %_lock. %_idle is
+	 *  notified when a connection is closed.
+	 */
+	std::mutex _lock;
+	std::condition_variable _idle;
+	std::vector<StrategyTable*> _tables;
+	std::vector<int> _clients;
+	std::thread _acceptor;
+};
+
+/**
+ *  @brief Connection to a DecisionServer.
+ */
+class DecisionClient {
+public:
+	/**
+	 *  @brief Connects to the server.
+	 *
+	 *  @param path Path of the socket.
+	 */
+	DecisionClient (const char* path);
+
+	/**
+	 *  @brief Closes the connection.
+	 */
+	~DecisionClient ();
+
+	/**
+	 *  @brief Returns false if the connection could not be made or failed.
+	 */
+	bool
+	valid () const { return _fd >= 0; }
+
+	/**
+	 *  @brief Sends a batch of queries and waits for the answers.
+	 *
+	 *  @param queries The queries, at most SERVER_MAX_BATCH.
+	 *  @param n Number of queries.
+	 *  @param answers Array of %n answers to fill.
+	 *  @return false if the connection failed.
+	 */
+	bool
+	query (const StrategyQuery* queries, int n, unsigned char* answers);
+
+private:
+	DecisionClient (const DecisionClient&);
+	DecisionClient& operator= (const DecisionClient&);
+
+	int _fd;
+	std::vector<char> _buffer;
+};
+
+/**
+ *  @brief Throughput and latency measured by generateLoad.
+ */
+struct LoadReport {
+	unsigned long int queries;
+	double seconds;
+
+	/**
+	 *  @brief Queries answered per second.
+	 */
+	double throughput;
+
+	/**
+	 *  @brief Round trip latencies, in microseconds.
+	 */
+	double p50, p99, max;
+};
+
+/**
+ *  @brief Loads a DecisionServer with random queries and measures it.
+ *
+ *  @param path Path of the socket.
+ *  @param clients Number of connections, each one used by its own thread.
+ *  @param batches Number of batches sent by each connection.
+ *  @param batch Number of queries of each batch.
+ *  @param strategies Queries name strategies between 0 and %strategies - 1.
+ */
+LoadReport
+generateLoad (const char* path, int clients, int batches, int batch, int strategies);
+
+#endif
@@ -0,0 +1,328 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <cmath>
+#include <algorithm>
+
+/**
+ *  @brief Normal quantile of a two sided 95% confidence interval.
+ */
+#define STATS_Z95 1.959964
+
+/**
+ *  @brief Running mean and variance of a stream of samples, updated with
+ *  Welford's method.
+ *
+ *  Accumulators of disjoint streams can be merged, and the result is the
+ *  same as if every sample had been added to one of them. This lets threads
+ *  or matches gather samples on their own and combine them afterwards.
+ */
+class RunningStats {
+public:
+	/**
+	 *  @brief Constructs an empty accumulator.
+	 */
+	RunningStats () : _n(0), _mean(0), _m2(0) {}
+
+	/**
+	 *  @brief Adds a sample.
+	 */
+	void
+	add (double x) {
+		_n++;
+		double delta = x - _mean;
+		_mean += delta/_n;
+		_m2 += delta*(x - _mean);
+	}
+
+	/**
+	 *  @brief Adds every sample of another accumulator.
+	 */
+	void
+	merge (const RunningStats& other) {
+		if (!other._n) return;
+		if (!_n){
+			*this = other;
+			return;
+		}
+
+		unsigned long int n = _n + other._n;
+		double delta = other._mean - _mean;
+		_mean += delta*other._n/n;
+		_m2 += other._m2 + delta*delta*_n*(double) other._n/n;
+		_n = n;
+	}
+
+	/**
+	 *  @brief Returns the samples added since an earlier copy of this
+	 *  accumulator. It undoes merge(), so %before merged with the result
+	 *  gives back this accumulator.
+	 */
+	RunningStats
+	since (const RunningStats& before) const {
+		RunningStats d;
+		d._n = _n - before._n;
+		if (!d._n) return d;
+		if (!before._n) return *this;
+
+		d._mean = (_mean*_n - before._mean*before._n)/d._n;
+		double delta = d._mean - before._mean;
+		d._m2 = _m2 - before._m2 - delta*delta*before._n*(double) d._n/_n;
+		if (d._m2 < 0) d._m2 = 0; // Rounding.
+		return d;
+	}
+
+	/**
+	 *  @brief Returns the number of samples.
+	 */
+	unsigned long int
+	count () const { return _n; }
+
+	/**
+	 *  @brief Returns the mean of the samples, 0 if there are none.
+	 */
+	double
+	mean () const { return _mean; }
+
+	/**
+	 *  @brief Returns the unbiased variance of the samples, 0 if there are
+	 *  less than two.
+	 */
+	double
+	variance () const { return (_n > 1) ? _m2/(_n - 1) : 0; }
+
+	/**
+	 *  @brief Returns the standard deviation of the samples.
+	 */
+	double
+	stddev () const { return sqrt(variance()); }
+
+	/**
+	 *  @brief Returns the standard error of the mean.
+	 */
+	double
+	stderror () const { return (_n) ? sqrt(variance()/_n) : 0; }
+
+	/**
+	 *  @brief Returns the half width of a normal confidence interval of the
+	 *  mean.
+	 *
+	 *  @param z Normal quantile of the confidence level.
+	 */
+	double
+	halfWidth (double z = STATS_Z95) const { return z*stderror(); }
+
+	/**
+	 *  @brief Returns the bounds of a normal confidence interval of the mean.
+	 */
+	double
+	lower (double z = STATS_Z95) const { return _mean - halfWidth(z); }
+
+	double
+	upper (double z = STATS_Z95) const { return _mean + halfWidth(z); }
+
+private:
+	unsigned long int _n;
+	double _mean;
+
+	/**
+	 *  Sum of the squared deviations from the mean.
+	 */
+	double _m2;
+};
+
+/**
+ *  @brief Running means and co-moments of a stream of pairs of samples,
+ *  updated and merged the same way as RunningStats.
+ *
+ *  It fits the least squares line of y on x, which is what a control
+ *  variate needs: if the mean of x is known, the mean of y can be corrected
+ *  by slope() times the difference between the observed and the known means
+ *  of x.
+ */
+class RunningCovariance {
+public:
+	/**
+	 *  @brief Constructs an empty accumulator.
+	 */
+	RunningCovariance () : _n(0), _mx(0), _my(0), _cxx(0), _cxy(0), _cyy(0) {}
+
+	/**
+	 *  @brief Adds a pair of samples.
+	 */
+	void
+	add (double x, double y) {
+		_n++;
+		double dx = x - _mx;
+		double dy = y - _my;
+		_mx += dx/_n;
+		_my += dy/_n;
+		_cxx += dx*(x - _mx);
+		_cxy += dx*(y - _my);
+		_cyy += dy*(y - _my);
+	}
+
+	/**
+	 *  @brief Adds every pair of another accumulator.
+	 */
+	void
+	merge (const RunningCovariance& other) {
+		if (!other._n) return;
+		if (!_n){
+			*this = other;
+			return;
+		}
+
+		unsigned long int n = _n + other._n;
+		double dx = other._mx - _mx;
+		double dy = other._my - _my;
+		double w = _n*(double) other._n/n;
+		_mx += dx*other._n/n;
+		_my += dy*other._n/n;
+		_cxx += other._cxx + dx*dx*w;
+		_cxy += other._cxy + dx*dy*w;
+		_cyy += other._cyy + dy*dy*w;
+		_n = n;
+	}
+
+	/**
+	 *  @brief Returns the pairs added since an earlier copy of this
+	 *  accumulator, as RunningStats::since.
+	 */
+	RunningCovariance
+	since (const RunningCovariance& before) const {
+		RunningCovariance d;
+		d._n = _n - before._n;
+		if (!d._n) return d;
+		if (!before._n) return *this;
+
+		d._mx = (_mx*_n - before._mx*before._n)/d._n;
+		d._my = (_my*_n - before._my*before._n)/d._n;
+		double dx = d._mx - before._mx;
+		double dy = d._my - before._my;
+		double w = before._n*(double) d._n/_n;
+		d._cxx = std::max(_cxx - before._cxx - dx*dx*w, 0.0);
+		d._cxy = _cxy - before._cxy - dx*dy*w;
+		d._cyy = std::max(_cyy - before._cyy - dy*dy*w, 0.0);
+		return d;
+	}
+
+	/**
+	 *  @brief Returns the number of pairs.
+	 */
+	unsigned long int
+	count () const { return _n; }
+
+	double
+	meanX () const { return _mx; }
+
+	double
+	meanY () const { return _my; }
+
+	/**
+	 *  @brief Returns the slope of the least squares line of y on x, 0 if x
+	 *  does not vary.
+	 */
+	double
+	slope () const { return (_cxx > 0) ? _cxy/_cxx : 0; }
+
+	/**
+	 *  @brief Returns the mean of y corrected by x, whose true mean is
+	 *  %mean.
+	 */
+	double
+	corrected (double mean = 0) const { return _my - slope()*(_mx - mean); }
+
+	/**
+	 *  @brief Returns the unbiased variance of y minus its part explained by
+	 *  x, which is the variance of the corrected samples.
+	 */
+	double
+	residualVariance () const {
+		if (_n < 3) return 0;
+		double r = _cyy - ((_cxx > 0) ? _cxy*_cxy/_cxx : 0);
+		return std::max(r, 0.0)/(_n - 2);
+	}
+
+private:
+	unsigned long int _n;
+	double _mx, _my;
+
+	/**
+	 *  Sums of the products of the deviations from the means.
+	 */
+	double _cxx, _cxy, _cyy;
+};
+
+/**
+ *  @brief Rule to stop a match once its outcome is known well enough.
+ *
+ *  It is checked after every hand against the results of the first player
+ *  since the start of the match. Heads-up, the other player's results are
+ *  the same with the opposite sign.
+ *
+ *  The winner is told by Wald's sequential probability ratio test between
+ *  a mean of -%delta and +%delta chips per hand, with the variance of the
+ *  hands played so far in place of the true one. It stops when the log
+ *  likelihood ratio leaves (-A, A), A = log((1 - alpha)/alpha), which keeps
+ *  the chance of naming the wrong winner of a pairing at least %delta apart
+ *  below %alpha however often it is checked. A fixed confidence interval
+ *  checked after every hand does not.
+ */
+struct SequentialTest {
+	/**
+	 *  @brief Hands played before the rule is checked for the first time,
+	 *  so that the variance is known well enough.
+	 */
+	int minHands;
+
+	/**
+	 *  @brief Smallest difference from 0, in chips per hand, worth telling
+	 *  the winner for. 0 disables the test.
+	 */
+	double delta;
+
+	/**
+	 *  @brief Chance of naming the wrong winner.
+	 */
+	double alpha;
+
+	/**
+	 *  @brief Stops when the half width of the 95% confidence interval, in
+	 *  chips per hand, falls below this. 0 disables it.
+	 */
+	double precision;
+
+	/**
+	 *  @brief Returns a rule that stops as soon as the winner is known.
+	 */
+	static SequentialTest
+	winner () {
+		SequentialTest t = {2000, 0.05, 0.01, 0};
+		return t;
+	}
+
+	/**
+	 *  @brief Returns the log likelihood ratio of a mean of +%delta against
+	 *  -%delta, 0 if the samples do not vary.
+	 */
+	double
+	logLikelihoodRatio (const RunningStats& s) const {
+		double v = s.variance();
+		return (v > 0) ? 2*delta*s.mean()*s.count()/v : 0;
+	}
+
+	/**
+	 *  @brief Returns true if the match can stop.
+	 *
+	 *  @param s Results of the first player since the match started.
+	 */
+	bool
+	resolved (const RunningStats& s) const {
+		if (s.count() < (unsigned long int) minHands || s.count() < 2) return false;
+		if (precision > 0 && s.halfWidth() < precision) return true;
+		return delta > 0 && fabs(logLikelihoodRatio(s)) >= log((1 - alpha)/alpha);
+	}
+};
+
+#endif
@@ -0,0 +1,28 @@
+#include "strategy.h"
+
+void
+CompiledStrategy::compileMaxStacks (int role, const int* maxStack){
+	int r = (role != PlayerRole::SB);
+	for (int s=0; s<COMPILED_ROWS; s++){
+		unsigned long long* mask = _masks[s][r];
+		for (int w=0; w<HAND_WORDS; w++) mask[w] = 0;
+
+		// The last row stands for every stack above COMPILED_MAX_STACK.
+		for (int h=0; h<NHANDS; h++)
+			if (s <= maxStack[h])
+				mask[h >> 6] |= 1ULL << (h & 63);
+	}
+}
+
+void
+CompiledStrategy::compileRange (int role, double percent){
+	int r = (role != PlayerRole::SB);
+	unsigned long long range[HAND_WORDS] = {0};
+	for (int h=0; h<NHANDS; h++)
+		if (handPercentTableCoords(h/NRANKS, h%NRANKS) < percent)
+			range[h >> 6] |= 1ULL << (h & 63);
+
+	for (int s=0; s<COMPILED_ROWS; s++)
+		for (int w=0; w<HAND_WORDS; w++)
+			_masks[s][r][w] = range[w];
+}
@@ -0,0 +1,114 @@
+#ifndef _STRATEGY_H_
+#define _STRATEGY_H_
+
+#include <cstring>
+
+#include "gameview.h"
+#include "handutils.h"
+
+/**
+ *  @brief Biggest effective stack with its own row in a compiled strategy.
+ *  Bigger stacks share one extra row.
+ */
+#define COMPILED_MAX_STACK 20
+#define COMPILED_ROWS (COMPILED_MAX_STACK + 2)
+
+/**
+ *  @brief Number of 64 bit words needed to hold one bit per hand.
+ */
+#define HAND_WORDS ((NHANDS + 63)/64)
+
+/**
+ *  @brief Push/fold strategy compiled into one bit per hand, role and
+ *  effective stack.
+ *
+ *  A set bit means that the player goes all-in as small blind, or calls the
+ *  shove as big blind. Hands are identified by handToNumeric. Players build
+ *  it once every time their parameters change, so that every decision is a
+ *  single bit test.
+ */
+class CompiledStrategy {
+public:
+	/**
+	 *  @brief Creates a strategy that always folds.
+	 */
+	CompiledStrategy () { clear(); }
+
+	/**
+	 *  @brief Makes the strategy fold every hand.
+	 */
+	void
+	clear () { memset(_masks, 0, sizeof(_masks)); }
+
+	/**
+	 *  @brief Makes the strategy fold every hand of a role at the given
+	 *  effective stack.
+	 */
+	void
+	clear (int role, int stack) {
+		memset(_masks[row(stack)][role != PlayerRole::SB], 0, sizeof(_masks[0][0])); }
+
+	/**
+	 *  @brief Returns true if the hand must be played at the given effective
+	 *  stack.
+	 *
+	 *  @param role SB to go all-in. Any other role calls.
+	 *  @param stack Effective stack.
+	 *  @param hand Numeric representation of the hand.
+	 */
+	bool
+	aggressive (int role, int stack, int hand) const {
+		const unsigned long long* mask = _masks[row(stack)][role != PlayerRole::SB];
+		return (mask[hand >> 6] >> (hand & 63)) & 1;
+	}
+
+	/**
+	 *  @brief Sets whether a hand is played at the given effective stack.
+	 */
+	void
+	aggressive (int role, int stack, int hand, bool b) {
+		unsigned long long* mask = _masks[row(stack)][role != PlayerRole::SB];
+		if (b) mask[hand >> 6] |= 1ULL << (hand & 63);
+		else mask[hand >> 6] &= ~(1ULL << (hand & 63));
+	}
+
+	/**
+	 *  @brief Compiles the strategy of a role given the biggest effective
+	 *  stack at which each hand is played.
+	 *
+	 *  @param role SB or BB.
+	 *  @param maxStack An array indexed by the numeric representation of
+	 *  the hand.
+	 */
+	void
+	compileMaxStacks (int role, const int* maxStack);
+
+	/**
+	 *  @brief Compiles the strategy of a role that plays the hands in the top
+	 *  %percent of the hand ranking no matter the effective stack.
+	 *
+	 *  @param role SB or BB.
+	 *  @param percent Portion of hands played, between 0 and 1.
+	 */
+	void
+	compileRange (int role, double percent);
+
+	/**
+	 *  @brief Returns the bits of every hand played at the given effective
+	 *  stack.
+	 */
+	const unsigned long long*
+	mask (int role, int stack) const { return _masks[row(stack)][role != PlayerRole::SB]; }
+
+	/**
+	 *  @brief Returns the row that holds the given effective stack.
+	 */
+	static int
+	row (int stack) {
+		return (stack < 0) ? 0 : (stack > COMPILED_MAX_STACK) ? COMPILED_MAX_STACK + 1 : stack; }
+
+private:
+	unsigned long long _masks[COMPILED_ROWS][2][HAND_WORDS];
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "sweep.h"
+
+StackSweep::StackSweep (Player& player1, Player& player2){
+	_players[0] = &player1;
+	_players[1] = &player2;
+	reset();
+}
+
+void
+StackSweep::reset (){
+	for (int p=0; p<2; p++)
+		for (int s=0; s<SWEEP_NSTACKS; s++)
+			_acc[p][s] = 0;
+	_nhands = 0;
+}
+
+void
+StackSweep::play (int n){
+	for (int i=0; i<n; i++){
+		Player* sb = _players[i % 2];
+		Player* bb = _players[(i+1) % 2];
+		double* accsb = _acc[i % 2];
+		double* accbb = _acc[(i+1) % 2];
+
+		_deck.shuffle();
+		sb->firstCard(_deck.popCard());
+		sb->secondCard(_deck.popCard());
+		bb->firstCard(_deck.popCard());
+		bb->secondCard(_deck.popCard());
+		for (int c=0; c<5; c++)
+			_board[c] = _deck.popCard();
+
+		sb->setRole(PlayerRole::SB);
+		bb->setRole(PlayerRole::BB);
+
+		// Share of the small blind. Only evaluated if some stack gets there.
+		double share = -1;
+
+		for (int s=SWEEP_MIN_STACK; s<=SWEEP_MAX_STACK; s++){
+			GameView view;
+			view.clear();
+			view.effectiveStack = s;
+			view.role = PlayerRole::SB;
+			view.pot = 3;
+			view.roundBet = 2;
+
+			Action* a = sb->action(view);
+			bool shove = (a->type() == ActionType::RAISE);
+			delete a;
+
+			if (!shove){
+				accsb[s - SWEEP_MIN_STACK] -= 1;
+				accbb[s - SWEEP_MIN_STACK] += 1;
+				continue;
+			}
+
+			view.push(ActionType::RAISE);
+			view.role = PlayerRole::BB;
+			view.pot = s + 2;
+			view.roundBet = s;
+
+			a = bb->action(view);
+			bool call = (a->type() == ActionType::CALL);
+			delete a;
+
+			if (!call){
+				accsb[s - SWEEP_MIN_STACK] += 2;
+				accbb[s - SWEEP_MIN_STACK] -= 2;
+				continue;
+			}
+
+			if (share < 0) share = showdown(sb,bb);
+			accsb[s - SWEEP_MIN_STACK] += s*(2*share - 1);
+			accbb[s - SWEEP_MIN_STACK] -= s*(2*share - 1);
+		}
+
+		_nhands++;
+	}
+}
+
+double
+StackSweep::showdown (Player* sb, Player* bb){
+	char hands[10];
+	char* tmp_hand = str_cards(sb->hand(),2);
+	strncpy(hands,tmp_hand,4);
+	delete [] tmp_hand;
+	hands[4] = ':';
+	tmp_hand = str_cards(bb->hand(),2);
+	strncpy(&hands[5],tmp_hand,4);
+	delete [] tmp_hand;
+	hands[9] = '\0';
+
+	char* str_com = str_cards(_board, 5);
+	char str_dead[] = "";
+	Results* res = alloc_results();
+
+	calc(hands, str_com, str_dead, MC_ITER, res);
+	double share = res->ev[0];
+
+	free_results(res);
+	delete [] str_com;
+
+	return share;
+}
@@ -0,0 +1,78 @@
+#ifndef _SWEEP_H_
+#define _SWEEP_H_
+
+#include "game.h"
+
+/**
+ *  @brief Smallest and biggest effective stacks evaluated by a sweep.
+ */
+#define SWEEP_MIN_STACK 3
+#define SWEEP_MAX_STACK 20
+#define SWEEP_NSTACKS (SWEEP_MAX_STACK - SWEEP_MIN_STACK + 1)
+
+/**
+ *  @brief Evaluates two push/fold players at every effective stack at once.
+ *
+ *  Each deal is played once per effective stack between SWEEP_MIN_STACK and
+ *  SWEEP_MAX_STACK, reusing the same cards and a single showdown evaluation,
+ *  so one run gives the whole EV curve of the match.
+ *
+ *  Only push/fold play is modelled: the small blind either raises all-in or
+ *  folds and the big blind either calls or folds. Any other action is taken
+ *  as a fold. The players' statistics are not updated, except for the
+ *  raise/call frequencies.
+ */
+class StackSweep {
+public:
+	/**
+	 *  @brief Creates the sweep for two players.
+	 *
+	 *  @param player1 An opponent.
+	 *  @param player2 Another opponent.
+	 */
+	StackSweep (Player& player1, Player& player2);
+
+	/**
+	 *  @brief Deals n hands and evaluates each of them at every stack. The
+	 *  players alternate the small blind.
+	 *
+	 *  @param n Number of hands to be dealt.
+	 */
+	void
+	play (int n);
+
+	/**
+	 *  @brief Returns the performance of a player at a certain effective
+	 *  stack, in the same units as Player::ev().
+	 *
+	 *  @param player 0 for the first player, 1 for the second.
+	 *  @param stack Effective stack.
+	 */
+	double
+	ev (int player, int stack) const {
+		return (_nhands) ? (_acc[player][stack - SWEEP_MIN_STACK]/_nhands)/2 : 0; }
+
+	/**
+	 *  @brief Returns the number of hands dealt so far.
+	 */
+	unsigned long int
+	hands_played () const { return _nhands; }
+
+	/**
+	 *  @brief Forgets every hand dealt so far.
+	 */
+	void
+	reset ();
+
+private:
+	double showdown (Player* sb, Player* bb);
+
+	Player* _players[2];
+	Deck _deck;
+	Card _board[5];
+
+	double _acc[2][SWEEP_NSTACKS];
+	unsigned long int _nhands;
+};
+
+#endif
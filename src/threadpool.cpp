@@ -0,0 +1,119 @@
+#include "threadpool.h"
+
+#include <algorithm>
+
+/**
+ *  Pool and queue of the thread running, if it belongs to a pool.
+ */
+static thread_local ThreadPool* currentPool = NULL;
+static thread_local int currentQueue = -1;
+
+ThreadPool::ThreadPool (int nthreads) :
+	_next(0),
+	_pending(0),
+	_stop(false) {
+	if (nthreads <= 0) nthreads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (int i=0; i<nthreads; i++)
+		_queues.push_back(new Queue());
+	for (int i=0; i<nthreads; i++)
+		_threads.push_back(std::thread(&ThreadPool::work, this, i));
+}
+
+ThreadPool::~ThreadPool (){
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_wake.notify_all();
+
+	for (std::vector<std::thread>::iterator it = _threads.begin(); it != _threads.end(); it++)
+		(*it).join();
+	for (std::vector<Queue*>::iterator it = _queues.begin(); it != _queues.end(); it++)
+		delete *it;
+}
+
+ThreadPool&
+ThreadPool::shared (){
+	static ThreadPool pool;
+	return pool;
+}
+
+void
+ThreadPool::submit (const Task& task){
+	int i = (currentPool == this) ? currentQueue : _next++ % _queues.size();
+	{
+		std::lock_guard<std::mutex> lock(_queues[i]->mutex);
+		_queues[i]->tasks.push_back(task);
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_pending++;
+	}
+	_wake.notify_one();
+}
+
+bool
+ThreadPool::take (int i, Task& task){
+	int n = _queues.size();
+	for (int k=0; k<n; k++){
+		Queue* q = _queues[(i + k) % n];
+		std::lock_guard<std::mutex> lock(q->mutex);
+		if (q->tasks.empty()) continue;
+
+		// Newest task of its own queue, oldest one of the others.
+		if (!k){
+			task = q->tasks.back();
+			q->tasks.pop_back();
+		}
+		else {
+			task = q->tasks.front();
+			q->tasks.pop_front();
+		}
+		return true;
+	}
+	return false;
+}
+
+void
+ThreadPool::work (int i){
+	currentPool = this;
+	currentQueue = i;
+
+	for (;;){
+		Task task;
+		if (take(i, task)){
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_pending--;
+			}
+			task();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (_stop && !_pending) return;
+		if (!_pending) _wake.wait(lock);
+	}
+}
+
+void
+TaskGroup::run (const ThreadPool::Task& task){
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_running++;
+	}
+
+	_pool.submit([this, task] (){
+		task();
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!--_running) _done.notify_all();
+	});
+}
+
+void
+TaskGroup::wait (){
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (_running)
+		_done.wait(lock);
+}
@@ -0,0 +1,125 @@
+#ifndef _THREADPOOL_H_
+#define _THREADPOOL_H_
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+/**
+ *  @brief Fixed set of threads running tasks, with a queue for each thread.
+ *
+ *  A thread takes the newest task of its own queue, and when it is empty
+ *  steals the oldest one of another queue. Tasks submitted from a task go to
+ *  the queue of the thread running it, others are spread between queues.
+ *  Threads sleep while there is nothing to do.
+ */
+class ThreadPool {
+public:
+	typedef std::function<void()> Task;
+
+	/**
+	 *  @brief Starts the threads.
+	 *
+	 *  @param nthreads Number of threads, 0 for one per core.
+	 */
+	ThreadPool (int nthreads = 0);
+
+	/**
+	 *  @brief Runs the tasks left and stops the threads.
+	 */
+	~ThreadPool ();
+
+	/**
+	 *  @brief Returns the pool shared by the whole program, with a thread
+	 *  per core. It is started the first time it is needed.
+	 */
+	static ThreadPool&
+	shared ();
+
+	/**
+	 *  @brief Queues a task.
+	 */
+	void
+	submit (const Task& task);
+
+	/**
+	 *  @brief Returns the number of threads.
+	 */
+	int
+	size () const { return _threads.size(); }
+
+private:
+	ThreadPool (const ThreadPool&);
+
+	ThreadPool&
+	operator= (const ThreadPool&);
+
+	struct Queue {
+		std::deque<Task> tasks;
+		std::mutex mutex;
+	};
+
+	void
+	work (int i);
+
+	bool
+	take (int i, Task& task);
+
+	std::vector<Queue*> _queues;
+	std::vector<std::thread> _threads;
+	std::atomic<unsigned int> _next;
+
+	/**
+	 *  Tasks queued and not taken yet, guarded by %_mutex along with %_stop.
+	 */
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	int _pending;
+	bool _stop;
+};
+
+/**
+ *  @brief Set of tasks run in a ThreadPool that can be waited for.
+ *
+ *  Tasks of the group may add more tasks to it, and wait() returns once all
+ *  of them are over. It must not be called from a task of the same pool.
+ */
+class TaskGroup {
+public:
+	/**
+	 *  @brief Constructs the group.
+	 */
+	TaskGroup (ThreadPool& pool = ThreadPool::shared()) :
+		_pool(pool),
+		_running(0) {}
+
+	/**
+	 *  @brief Waits for the tasks of the group.
+	 */
+	~TaskGroup () { wait(); }
+
+	/**
+	 *  @brief Runs a task in the pool.
+	 */
+	void
+	run (const ThreadPool::Task& task);
+
+	/**
+	 *  @brief Waits until every task of the group is over.
+	 */
+	void
+	wait ();
+
+private:
+	ThreadPool& _pool;
+
+	std::mutex _mutex;
+	std::condition_variable _done;
+	int _running;
+};
+
+#endif